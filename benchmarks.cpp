@@ -0,0 +1,1036 @@
+#include "question_mark.hpp"
+#include "question_mark_atomic.hpp"
+#include "question_mark_box.hpp"
+#include "question_mark_error.hpp"
+#include "question_mark_iter.hpp"
+#include "question_mark_parallel.hpp"
+#include "question_mark_vector.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <optional>
+#define QUESTION_MARK_BENCH_OPTIONAL 1
+#else
+#define QUESTION_MARK_BENCH_OPTIONAL 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define QUESTION_MARK_BENCH_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define QUESTION_MARK_BENCH_NOINLINE __declspec(noinline)
+#else
+#define QUESTION_MARK_BENCH_NOINLINE
+#endif
+
+/// Functions measured for code size are placed in their own ELF sections whose
+/// bounds the linker exposes as __start_NAME and __stop_NAME. They are aligned
+/// equally, so loop placement does not skew their timings.
+#if defined(__ELF__) && (defined(__GNUC__) || defined(__clang__))
+#define QUESTION_MARK_BENCH_CODE_SIZE 1
+#define QUESTION_MARK_BENCH_SECTION(NAME) __attribute__((section(#NAME), aligned(64)))
+#define QUESTION_MARK_BENCH_SECTION_BOUNDS(NAME) extern "C" const char __start_##NAME[], __stop_##NAME[]
+#define QUESTION_MARK_BENCH_SECTION_SIZE(NAME) std::size_t(__stop_##NAME - __start_##NAME)
+#else
+#define QUESTION_MARK_BENCH_CODE_SIZE 0
+#define QUESTION_MARK_BENCH_SECTION(NAME)
+#endif
+
+#if QUESTION_MARK_BENCH_CODE_SIZE
+QUESTION_MARK_BENCH_SECTION_BOUNDS(qm_sum_inline_panic);
+QUESTION_MARK_BENCH_SECTION_BOUNDS(qm_sum_unwrap);
+QUESTION_MARK_BENCH_SECTION_BOUNDS(qm_sum_unwrap_unchecked);
+#endif
+
+namespace benchmarks {
+    /// Heap usage recorded by the global operator new
+    struct {
+        std::atomic<std::size_t> allocations{0};
+        std::atomic<std::size_t> bytes{0};
+    } heap;
+}
+
+/// The replacements pair malloc with free. They stay out of line, so GCC does
+/// not see free called on pointers of new expressions and warn about it.
+QUESTION_MARK_BENCH_NOINLINE void* operator new(std::size_t size) {
+    benchmarks::heap.allocations.fetch_add(1, std::memory_order_relaxed);
+    benchmarks::heap.bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+QUESTION_MARK_BENCH_NOINLINE void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+QUESTION_MARK_BENCH_NOINLINE void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace benchmarks {
+    /// Keeps the compiler from optimizing given value away
+    template <typename T>
+    inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    /// Result of a single benchmark
+    struct Measurement {
+        double ns_per_op;
+        double allocations_per_op;
+        double bytes_per_op;
+    };
+
+    /// Runs benchmarks selected on the command line, prints their results and
+    /// compares them against a saved baseline
+    class Runner {
+    public:
+        Runner(int argc, char** argv) {
+            for (int i = 1; i < argc; ++i) {
+                std::string arg = argv[i];
+                std::string value = i + 1 < argc ? argv[i + 1] : "";
+                if (arg == "--filter") {
+                    _filter = value;
+                } else if (arg == "--baseline") {
+                    _baseline = load(value);
+                } else if (arg == "--save") {
+                    _save = value;
+                } else if (arg == "--threshold") {
+                    _threshold = std::atof(value.c_str());
+                } else if (arg == "--min-time") {
+                    _min_time_ns = std::atof(value.c_str()) * 1e6;
+                } else {
+                    std::fprintf(stderr, "usage: %s [--filter substring] [--min-time ms] "
+                                         "[--save file] [--baseline file] [--threshold percent]\n", argv[0]);
+                    std::exit(2);
+                }
+                ++i;
+            }
+
+            std::printf("%-56s %12s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "bytes/op");
+        }
+
+        /// Measures given operation called with consecutive indices
+        template <typename F>
+        void run(const std::string& name, F&& op) {
+            run(name, 1, std::forward<F>(op));
+        }
+
+        /// Measures given operation which performs given number of
+        /// operations per call
+        template <typename F>
+        void run(const std::string& name, std::size_t ops_per_call, F&& op) {
+            check_name(name);
+            if (name.find(_filter) == std::string::npos) {
+                return;
+            }
+
+            std::size_t iterations = 1;
+            while (time(op, iterations) < _min_time_ns && iterations < (std::size_t(1) << 40)) {
+                iterations *= 2;
+            }
+
+            double best = time(op, iterations);
+            for (int round = 0; round < 2; ++round) {
+                best = std::min(best, time(op, iterations));
+            }
+
+            std::size_t allocations = heap.allocations;
+            std::size_t bytes = heap.bytes;
+            time(op, iterations);
+
+            double ops = double(iterations) * double(ops_per_call);
+            Measurement measurement{
+                best / ops,
+                double(heap.allocations - allocations) / ops,
+                double(heap.bytes - bytes) / ops,
+            };
+            _results[name] = measurement;
+
+            std::printf("%-56s %12.2f %12.2f %12.2f\n", name.c_str(),
+                        measurement.ns_per_op, measurement.allocations_per_op, measurement.bytes_per_op);
+            std::fflush(stdout);
+        }
+
+        /// Prints size of the machine code of a benchmarked function
+        void code_size(const std::string& name, std::size_t bytes) const {
+            check_name(name);
+            if (name.find(_filter) == std::string::npos) {
+                return;
+            }
+
+            std::printf("%-56s %12zu bytes of code\n", name.c_str(), bytes);
+        }
+
+        /// Saves results and reports regressions against the baseline,
+        /// returns process exit code
+        int finish() const {
+            if (!_save.empty()) {
+                std::ofstream file(_save);
+                for (const auto& result : _results) {
+                    file << result.first << ' ' << result.second.ns_per_op << ' '
+                         << result.second.allocations_per_op << ' ' << result.second.bytes_per_op << '\n';
+                }
+            }
+
+            int regressions = 0;
+            for (const auto& result : _results) {
+                auto baseline = _baseline.find(result.first);
+                if (baseline == _baseline.end()) {
+                    continue;
+                }
+
+                double limit = baseline->second.ns_per_op * (1.0 + _threshold / 100.0);
+                bool slower = result.second.ns_per_op > limit;
+                bool allocates = result.second.allocations_per_op > baseline->second.allocations_per_op;
+                if (slower || allocates) {
+                    std::printf("REGRESSION %s: %.2f ns/op %.2f allocs/op (baseline %.2f ns/op %.2f allocs/op)\n",
+                                result.first.c_str(), result.second.ns_per_op, result.second.allocations_per_op,
+                                baseline->second.ns_per_op, baseline->second.allocations_per_op);
+                    ++regressions;
+                }
+            }
+
+            return regressions == 0 ? 0 : 1;
+        }
+
+    private:
+        template <typename F>
+        static double time(F& op, std::size_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < iterations; ++i) {
+                op(i);
+            }
+            auto stop = std::chrono::steady_clock::now();
+
+            return double(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+        }
+
+        /// Reads results saved by finish - one "name ns allocs bytes" line per
+        /// benchmark. A missing file or a malformed line ends the process, so
+        /// no benchmark silently goes without its baseline.
+        static std::map<std::string, Measurement> load(const std::string& path) {
+            std::map<std::string, Measurement> results;
+            std::ifstream file(path);
+            if (!file) {
+                std::fprintf(stderr, "cannot read baseline %s\n", path.c_str());
+                std::exit(2);
+            }
+
+            std::string line;
+            for (int number = 1; std::getline(file, line); ++number) {
+                std::istringstream fields(line);
+                std::string name;
+                std::string rest;
+                Measurement measurement{};
+                if (!(fields >> name >> measurement.ns_per_op >> measurement.allocations_per_op
+                             >> measurement.bytes_per_op) || fields >> rest) {
+                    std::fprintf(stderr, "%s:%d: malformed baseline line: %s\n", path.c_str(), number, line.c_str());
+                    std::exit(2);
+                }
+                results[name] = measurement;
+            }
+
+            return results;
+        }
+
+        /// Names are saved as whitespace separated fields, so they must not
+        /// contain any whitespace
+        static void check_name(const std::string& name) {
+            if (name.empty() || name.find_first_of(" \t\n") != std::string::npos) {
+                std::fprintf(stderr, "invalid benchmark name \"%s\"\n", name.c_str());
+                std::exit(2);
+            }
+        }
+
+        std::string _filter;
+        std::string _save;
+        std::map<std::string, Measurement> _baseline;
+        std::map<std::string, Measurement> _results;
+        double _threshold = 10.0;
+        double _min_time_ns = 50e6;
+    };
+
+    /// Lookup table where negative entries mean missing values
+    constexpr std::size_t table_mask = 1023;
+    int table[table_mask + 1];
+
+    /// Index of an entry which is always present
+    inline std::size_t present(std::size_t i) {
+        return (i | 1) & table_mask;
+    }
+
+    inline Option<int> find_option(std::size_t i) {
+        int value = table[i & table_mask];
+        return value < 0 ? Option<int>::None() : Option<int>::Some(value);
+    }
+
+#if QUESTION_MARK_BENCH_OPTIONAL
+    inline std::optional<int> find_optional(std::size_t i) {
+        int value = table[i & table_mask];
+        return value < 0 ? std::nullopt : std::optional<int>(value);
+    }
+#endif
+
+    inline const int* find_pointer(std::size_t i) {
+        const int* value = &table[i & table_mask];
+        return *value < 0 ? nullptr : value;
+    }
+
+    inline int find_sentinel(std::size_t i) {
+        return table[i & table_mask];
+    }
+
+    void construction(Runner& runner) {
+        runner.run("construct/Option", [](std::size_t i) {
+            do_not_optimize(find_option(i));
+        });
+        runner.run("construct/Result", [](std::size_t i) {
+            int value = table[i & table_mask];
+            do_not_optimize(value < 0 ? Result<int, int>::Err(value) : Result<int, int>::Ok(value));
+        });
+#if QUESTION_MARK_BENCH_OPTIONAL
+        runner.run("construct/std::optional", [](std::size_t i) {
+            do_not_optimize(find_optional(i));
+        });
+#endif
+        runner.run("construct/pointer", [](std::size_t i) {
+            do_not_optimize(find_pointer(i));
+        });
+        runner.run("construct/sentinel", [](std::size_t i) {
+            do_not_optimize(find_sentinel(i));
+        });
+        runner.run("construct/Option<std::string>", [](std::size_t i) {
+            do_not_optimize(Option<std::string>::Some(std::string(i & 1 ? "short" : "string")));
+        });
+    }
+
+    /// Option::unwrap as it was expanded before panics moved out of line
+    inline int unwrap_inline_panic(const Option<int>& option) {
+        if (option.is_none()) {
+            std::cout << "Program panicked! Error: " << "Option::unwrap() called on a None" << std::endl;
+            exit(1);
+        }
+
+        return *option.iter().begin();
+    }
+
+    constexpr std::size_t unwrap_batch = 64;
+
+    QUESTION_MARK_BENCH_NOINLINE QUESTION_MARK_BENCH_SECTION(qm_sum_inline_panic)
+    long sum_inline_panic(const Option<int>* options) {
+        long sum = 0;
+        for (std::size_t i = 0; i < unwrap_batch; ++i) {
+            sum += unwrap_inline_panic(options[i]);
+        }
+        return sum;
+    }
+
+    QUESTION_MARK_BENCH_NOINLINE QUESTION_MARK_BENCH_SECTION(qm_sum_unwrap)
+    long sum_unwrap(const Option<int>* options) {
+        long sum = 0;
+        for (std::size_t i = 0; i < unwrap_batch; ++i) {
+            sum += options[i].unwrap();
+        }
+        return sum;
+    }
+
+    QUESTION_MARK_BENCH_NOINLINE QUESTION_MARK_BENCH_SECTION(qm_sum_unwrap_unchecked)
+    long sum_unwrap_unchecked(const Option<int>* options) {
+        long sum = 0;
+        for (std::size_t i = 0; i < unwrap_batch; ++i) {
+            sum += options[i].unwrap_unchecked();
+        }
+        return sum;
+    }
+
+    void unwrapping(Runner& runner) {
+        std::vector<Option<int>> options;
+        for (std::size_t i = 0; i < unwrap_batch; ++i) {
+            options.push_back(find_option(present(i)));
+        }
+        runner.run("unwrap_loop/inline_panic", unwrap_batch, [&](std::size_t) {
+            do_not_optimize(sum_inline_panic(options.data()));
+        });
+        runner.run("unwrap_loop/unwrap", unwrap_batch, [&](std::size_t) {
+            do_not_optimize(sum_unwrap(options.data()));
+        });
+        runner.run("unwrap_loop/unwrap_unchecked", unwrap_batch, [&](std::size_t) {
+            do_not_optimize(sum_unwrap_unchecked(options.data()));
+        });
+#if QUESTION_MARK_BENCH_CODE_SIZE
+        runner.code_size("unwrap_loop/inline_panic", QUESTION_MARK_BENCH_SECTION_SIZE(qm_sum_inline_panic));
+        runner.code_size("unwrap_loop/unwrap", QUESTION_MARK_BENCH_SECTION_SIZE(qm_sum_unwrap));
+        runner.code_size("unwrap_loop/unwrap_unchecked", QUESTION_MARK_BENCH_SECTION_SIZE(qm_sum_unwrap_unchecked));
+#endif
+
+        runner.run("unwrap/Option", [](std::size_t i) {
+            do_not_optimize(find_option(present(i)).unwrap());
+        });
+#if QUESTION_MARK_BENCH_OPTIONAL
+        runner.run("unwrap/std::optional", [](std::size_t i) {
+            do_not_optimize(find_optional(present(i)).value());
+        });
+#endif
+        runner.run("unwrap/pointer", [](std::size_t i) {
+            do_not_optimize(*find_pointer(present(i)));
+        });
+
+        runner.run("unwrap_or/Option", [](std::size_t i) {
+            do_not_optimize(find_option(i).unwrap_or(0));
+        });
+#if QUESTION_MARK_BENCH_OPTIONAL
+        runner.run("unwrap_or/std::optional", [](std::size_t i) {
+            do_not_optimize(find_optional(i).value_or(0));
+        });
+#endif
+        runner.run("unwrap_or/pointer", [](std::size_t i) {
+            const int* value = find_pointer(i);
+            do_not_optimize(value != nullptr ? *value : 0);
+        });
+        runner.run("unwrap_or/sentinel", [](std::size_t i) {
+            int value = find_sentinel(i);
+            do_not_optimize(value < 0 ? 0 : value);
+        });
+    }
+
+    void chaining(Runner& runner) {
+        auto twice = [](int value) {return value * 2;};
+
+        runner.run("map_and_then/Option", [&](std::size_t i) {
+            do_not_optimize(find_option(i).map(twice).and_then([&]{return find_option(i + 1);}).unwrap_or(0));
+        });
+#if QUESTION_MARK_BENCH_OPTIONAL
+        runner.run("map_and_then/std::optional", [&](std::size_t i) {
+            auto value = find_optional(i);
+            auto doubled = value ? std::optional<int>(twice(*value)) : std::nullopt;
+            auto next = doubled ? find_optional(i + 1) : std::nullopt;
+            do_not_optimize(next.value_or(0));
+        });
+#endif
+        runner.run("map_and_then/pointer", [&](std::size_t i) {
+            const int* value = find_pointer(i);
+            int doubled = 0;
+            const int* mapped = value != nullptr ? (doubled = twice(*value), &doubled) : nullptr;
+            const int* next = mapped != nullptr ? find_pointer(i + 1) : nullptr;
+            do_not_optimize(next != nullptr ? *next : 0);
+        });
+        runner.run("map_and_then/sentinel", [&](std::size_t i) {
+            int value = find_sentinel(i);
+            int doubled = value < 0 ? -1 : twice(value);
+            int next = doubled < 0 ? -1 : find_sentinel(i + 1);
+            do_not_optimize(next < 0 ? 0 : next);
+        });
+
+        runner.run("ok_or/Option", [](std::size_t i) {
+            do_not_optimize(find_option(i).ok_or(-1).is_ok());
+        });
+#if QUESTION_MARK_BENCH_OPTIONAL
+        runner.run("ok_or/std::optional", [](std::size_t i) {
+            auto value = find_optional(i);
+            do_not_optimize(value ? Result<int, int>::Ok(*value).is_ok() : Result<int, int>::Err(-1).is_ok());
+        });
+#endif
+        runner.run("ok_or/sentinel", [](std::size_t i) {
+            do_not_optimize(find_sentinel(i) >= 0);
+        });
+    }
+
+    /// Number of stack frames an error is propagated through
+    constexpr int depth = 16;
+
+    /// Error thrown by the exception based propagation
+    struct Failure {
+        int code;
+    };
+
+    template <int N>
+    QUESTION_MARK_BENCH_NOINLINE Result<int, int> propagate_result(int value) {
+        auto result = propagate_result<N - 1>(value);
+        if (result.is_err()) {
+            return result;
+        }
+
+        return Result<int, int>::Ok(std::move(result).ok().unwrap() + 1);
+    }
+
+    template <>
+    QUESTION_MARK_BENCH_NOINLINE Result<int, int> propagate_result<0>(int value) {
+        return value < 0 ? Result<int, int>::Err(value) : Result<int, int>::Ok(value);
+    }
+
+    template <int N>
+    QUESTION_MARK_BENCH_NOINLINE Result<int, int> propagate_try(int value) {
+        TRY(int result, propagate_try<N - 1>(value));
+        return Result<int, int>::Ok(result + 1);
+    }
+
+    template <>
+    QUESTION_MARK_BENCH_NOINLINE Result<int, int> propagate_try<0>(int value) {
+        return propagate_result<0>(value);
+    }
+
+#if QUESTION_MARK_HAS_COROUTINES
+    template <int N>
+    QUESTION_MARK_BENCH_NOINLINE Result<int, int> propagate_coroutine(int value) {
+        int result = co_await propagate_coroutine<N - 1>(value);
+        co_return result + 1;
+    }
+
+    template <>
+    QUESTION_MARK_BENCH_NOINLINE Result<int, int> propagate_coroutine<0>(int value) {
+        return propagate_result<0>(value);
+    }
+#endif
+
+    template <int N>
+    QUESTION_MARK_BENCH_NOINLINE int propagate_sentinel(int value) {
+        int result = propagate_sentinel<N - 1>(value);
+        if (result < 0) {
+            return result;
+        }
+
+        return result + 1;
+    }
+
+    template <>
+    QUESTION_MARK_BENCH_NOINLINE int propagate_sentinel<0>(int value) {
+        return value;
+    }
+
+    template <int N>
+    QUESTION_MARK_BENCH_NOINLINE int propagate_exception(int value) {
+        return propagate_exception<N - 1>(value) + 1;
+    }
+
+    template <>
+    QUESTION_MARK_BENCH_NOINLINE int propagate_exception<0>(int value) {
+        if (value < 0) {
+            throw Failure{value};
+        }
+
+        return value;
+    }
+
+    void propagation(Runner& runner) {
+        const std::string frames = std::to_string(depth);
+
+        runner.run("propagate_ok/" + frames + "/Result", [](std::size_t i) {
+            do_not_optimize(propagate_result<depth>(int(i & 0xff)).is_ok());
+        });
+        runner.run("propagate_ok/" + frames + "/TRY", [](std::size_t i) {
+            do_not_optimize(propagate_try<depth>(int(i & 0xff)).is_ok());
+        });
+#if QUESTION_MARK_HAS_COROUTINES
+        runner.run("propagate_ok/" + frames + "/co_await", [](std::size_t i) {
+            do_not_optimize(propagate_coroutine<depth>(int(i & 0xff)).is_ok());
+        });
+#endif
+        runner.run("propagate_ok/" + frames + "/sentinel", [](std::size_t i) {
+            do_not_optimize(propagate_sentinel<depth>(int(i & 0xff)));
+        });
+        runner.run("propagate_ok/" + frames + "/exception", [](std::size_t i) {
+            try {
+                do_not_optimize(propagate_exception<depth>(int(i & 0xff)));
+            } catch (const Failure& failure) {
+                do_not_optimize(failure.code);
+            }
+        });
+
+        runner.run("propagate_err/" + frames + "/Result", [](std::size_t i) {
+            do_not_optimize(propagate_result<depth>(-int(i & 0xff) - 1).is_err());
+        });
+        runner.run("propagate_err/" + frames + "/TRY", [](std::size_t i) {
+            do_not_optimize(propagate_try<depth>(-int(i & 0xff) - 1).is_err());
+        });
+#if QUESTION_MARK_HAS_COROUTINES
+        runner.run("propagate_err/" + frames + "/co_await", [](std::size_t i) {
+            do_not_optimize(propagate_coroutine<depth>(-int(i & 0xff) - 1).is_err());
+        });
+#endif
+        runner.run("propagate_err/" + frames + "/sentinel", [](std::size_t i) {
+            do_not_optimize(propagate_sentinel<depth>(-int(i & 0xff) - 1));
+        });
+        runner.run("propagate_err/" + frames + "/exception", [](std::size_t i) {
+            try {
+                do_not_optimize(propagate_exception<depth>(-int(i & 0xff) - 1));
+            } catch (const Failure& failure) {
+                do_not_optimize(failure.code);
+            }
+        });
+    }
+
+    /// Hand-written collection of successful values - the loop replaced by collect
+    Result<std::vector<int>, int> collect_loop(const std::vector<Result<int, int>>& results) {
+        std::vector<int> values;
+        for (const auto& result : results) {
+            if (result.is_err()) {
+                return Result<std::vector<int>, int>::Err(result.unwrap_err());
+            }
+            values.push_back(result.unwrap());
+        }
+
+        return Result<std::vector<int>, int>::Ok(std::move(values));
+    }
+
+    void sequences(Runner& runner) {
+        constexpr std::size_t size = std::size_t(1) << 20;
+        std::vector<Result<int, int>> results;
+        std::vector<Option<int>> options;
+        for (std::size_t i = 0; i < size; ++i) {
+            int value = table[i & table_mask];
+            results.push_back(Result<int, int>::Ok(value & 0xff));
+            options.push_back(value < 0 ? Option<int>::None() : Option<int>::Some(value));
+        }
+        auto failing = results;
+        failing[1000] = Result<int, int>::Err(-1);
+
+        runner.run("sequence/collect/loop", size, [&](std::size_t) {
+            do_not_optimize(collect_loop(results).is_ok());
+        });
+        runner.run("sequence/collect/collect", size, [&](std::size_t) {
+            do_not_optimize(question_mark::collect(results).is_ok());
+        });
+        runner.run("sequence/collect_early_err/loop", size, [&](std::size_t) {
+            do_not_optimize(collect_loop(failing).is_ok());
+        });
+        runner.run("sequence/collect_early_err/collect", size, [&](std::size_t) {
+            do_not_optimize(question_mark::collect(failing).is_ok());
+        });
+
+        runner.run("sequence/try_fold/loop", size, [&](std::size_t) {
+            long sum = 0;
+            for (const auto& result : results) {
+                if (result.is_err()) {
+                    break;
+                }
+                sum += result.unwrap();
+            }
+            do_not_optimize(sum);
+        });
+        runner.run("sequence/try_fold/try_fold", size, [&](std::size_t) {
+            auto sum = question_mark::try_fold(results, 0L, [](long sum, const Result<int, int>& result) {
+                return result.is_ok() ? Result<long, int>::Ok(sum + result.unwrap()) : Result<long, int>::Err(result.unwrap_err());
+            });
+            do_not_optimize(sum.is_ok());
+        });
+
+        runner.run("sequence/flatten/loop", size, [&](std::size_t) {
+            long sum = 0;
+            for (const auto& option : options) {
+                if (option.is_some()) {
+                    sum += option.unwrap();
+                }
+            }
+            do_not_optimize(sum);
+        });
+        runner.run("sequence/flatten/flatten", size, [&](std::size_t) {
+            long sum = 0;
+            for (int value : question_mark::flatten(options)) {
+                sum += value;
+            }
+            do_not_optimize(sum);
+        });
+
+        auto small = [](int value) {
+            return value < 128 ? Option<int>::Some(value * 2) : Option<int>::None();
+        };
+        runner.run("sequence/filter_map/loop", size, [&](std::size_t) {
+            std::vector<int> values;
+            for (const auto& result : results) {
+                auto mapped = small(result.unwrap());
+                if (mapped.is_some()) {
+                    values.push_back(mapped.unwrap());
+                }
+            }
+            do_not_optimize(values.data());
+        });
+        runner.run("sequence/filter_map/filter_map", size, [&](std::size_t) {
+            auto mapped = question_mark::filter_map(results, [&](const Result<int, int>& result) {
+                return small(result.unwrap());
+            });
+            std::vector<int> values;
+            for (int value : mapped) {
+                values.push_back(value);
+            }
+            do_not_optimize(values.data());
+        });
+    }
+
+    /// Node of a binary tree keeping its children in boxes
+    struct TreeNode {
+        int value;
+        question_mark::BoxedOption<TreeNode> left;
+        question_mark::BoxedOption<TreeNode> right;
+    };
+
+    /// Node of the same tree keeping its children in unique pointers
+    struct UniqueTreeNode {
+        int value;
+        Option<std::unique_ptr<UniqueTreeNode>> left;
+        Option<std::unique_ptr<UniqueTreeNode>> right;
+    };
+
+    /// Builds balanced tree of nodes with consecutive values
+    question_mark::BoxedOption<TreeNode> build_tree(question_mark::memory_resource& resource, int first, int count) {
+        if (count == 0) {
+            return question_mark::BoxedOption<TreeNode>::None();
+        }
+
+        int half = count / 2;
+        return question_mark::BoxedOption<TreeNode>::Some(question_mark::Box<TreeNode>::make_in(resource, TreeNode{
+            first + half, build_tree(resource, first, half), build_tree(resource, first + half + 1, count - half - 1)}));
+    }
+
+    Option<std::unique_ptr<UniqueTreeNode>> build_unique_tree(int first, int count) {
+        if (count == 0) {
+            return Option<std::unique_ptr<UniqueTreeNode>>::None();
+        }
+
+        int half = count / 2;
+        return Option<std::unique_ptr<UniqueTreeNode>>::Some(std::unique_ptr<UniqueTreeNode>(new UniqueTreeNode{
+            first + half, build_unique_tree(first, half), build_unique_tree(first + half + 1, count - half - 1)}));
+    }
+
+    template <typename Node>
+    long sum_tree(const Option<Node>& tree) {
+        long sum = 0;
+        for (const auto& node : tree.iter()) {
+            sum += node->value + sum_tree(node->left) + sum_tree(node->right);
+        }
+
+        return sum;
+    }
+
+    void trees(Runner& runner) {
+        constexpr int nodes = 100000;
+
+        runner.run("tree/std::unique_ptr", nodes, [&](std::size_t) {
+            auto tree = build_unique_tree(0, nodes);
+            do_not_optimize(sum_tree(tree));
+        });
+        runner.run("tree/Box_heap", nodes, [&](std::size_t) {
+            auto tree = build_tree(*question_mark::new_delete_resource(), 0, nodes);
+            do_not_optimize(sum_tree(tree));
+        });
+
+        question_mark::monotonic_arena arena;
+        runner.run("tree/Box_arena", nodes, [&](std::size_t) {
+            {
+                auto tree = build_tree(arena, 0, nodes);
+                do_not_optimize(sum_tree(tree));
+            }
+            arena.reset();
+        });
+    }
+
+    /// Codes of the lookup error domain
+    enum class LookupError {
+        Missing = 1
+    };
+}
+
+namespace question_mark {
+    template <>
+    struct error_traits<benchmarks::LookupError> {
+        static const error_domain& domain() {
+            static const char* const messages[] = {"no error", "value missing from the lookup table"};
+            static const error_domain domain("lookup", messages);
+            return domain;
+        }
+    };
+}
+
+namespace benchmarks {
+    QUESTION_MARK_BENCH_NOINLINE Result<int, std::string> lookup_string(std::size_t i) {
+        int value = table[i & table_mask];
+        return value < 0 ? Result<int, std::string>::Err("value missing from the lookup table")
+                         : Result<int, std::string>::Ok(value);
+    }
+
+    QUESTION_MARK_BENCH_NOINLINE Result<int, question_mark::Error> lookup_error(std::size_t i) {
+        int value = table[i & table_mask];
+        return value < 0 ? Result<int, question_mark::Error>::Err(LookupError::Missing)
+                         : Result<int, question_mark::Error>::Ok(value);
+    }
+
+    QUESTION_MARK_BENCH_NOINLINE Result<int, question_mark::Error> lookup_with_context(std::size_t i) {
+        return question_mark::with_context(lookup_error(i), "reading table");
+    }
+
+    void errors(Runner& runner) {
+        const std::string missing = "value missing from the lookup table";
+
+        runner.run("error/fail/std::string", [](std::size_t i) {
+            do_not_optimize(lookup_string(i & ~table_mask).is_err());
+        });
+        runner.run("error/fail/Error", [](std::size_t i) {
+            do_not_optimize(lookup_error(i & ~table_mask).is_err());
+        });
+        runner.run("error/fail/Error_context", [](std::size_t i) {
+            do_not_optimize(lookup_with_context(i & ~table_mask).is_err());
+        });
+
+        runner.run("error/contains_err/std::string", [&](std::size_t i) {
+            do_not_optimize(lookup_string(i).contains_err(missing));
+        });
+        runner.run("error/contains_err/Error", [](std::size_t i) {
+            do_not_optimize(lookup_error(i).contains_err(LookupError::Missing));
+        });
+
+        runner.run("error/succeed/std::string", [](std::size_t i) {
+            do_not_optimize(lookup_string(present(i)).unwrap_or(0));
+        });
+        runner.run("error/succeed/Error", [](std::size_t i) {
+            do_not_optimize(lookup_error(present(i)).unwrap_or(0));
+        });
+    }
+
+    /// Option guarded by a mutex - the slot AtomicOption replaces
+    template <typename T>
+    class MutexOption {
+    public:
+        Option<T> take() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _value.take();
+        }
+
+        Option<T> replace(T value) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _value.replace(std::move(value));
+        }
+
+    private:
+        std::mutex _mutex;
+        Option<T> _value = Option<T>::None();
+    };
+
+    /// Makes given number of replace and take pairs on a shared slot from
+    /// each of the threads
+    template <typename Slot, typename T>
+    void contend(Slot& slot, unsigned threads, std::size_t pairs, const T& value) {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                for (std::size_t i = 0; i < pairs; ++i) {
+                    do_not_optimize(slot.replace(value).is_some());
+                    do_not_optimize(slot.take().is_some());
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /// Thread counts from 1 doubling up to the hardware concurrency, at least 2
+    std::vector<unsigned> thread_counts() {
+        unsigned limit = std::max(2u, std::thread::hardware_concurrency());
+        std::vector<unsigned> counts;
+        for (unsigned threads = 1; threads < limit; threads *= 2) {
+            counts.push_back(threads);
+        }
+        counts.push_back(limit);
+
+        return counts;
+    }
+
+    void handoffs(Runner& runner) {
+        constexpr std::size_t pairs = 100000;
+        const std::string text = "payload";
+
+        for (unsigned threads : thread_counts()) {
+            const std::string suffix = "/" + std::to_string(threads) + "_threads";
+            const std::size_t ops = 2 * pairs * threads;
+
+            question_mark::AtomicOption<int> atomic_int;
+            runner.run("handoff/int/AtomicOption" + suffix, ops, [&](std::size_t) {
+                contend(atomic_int, threads, pairs, 1);
+            });
+            MutexOption<int> mutex_int;
+            runner.run("handoff/int/mutex" + suffix, ops, [&](std::size_t) {
+                contend(mutex_int, threads, pairs, 1);
+            });
+
+            question_mark::AtomicOption<std::string> atomic_string;
+            runner.run("handoff/std::string/AtomicOption" + suffix, ops, [&](std::size_t) {
+                contend(atomic_string, threads, pairs, text);
+            });
+            MutexOption<std::string> mutex_string;
+            runner.run("handoff/std::string/mutex" + suffix, ops, [&](std::size_t) {
+                contend(mutex_string, threads, pairs, text);
+            });
+        }
+    }
+
+    /// Checks a record with a few dozen dependent multiplications, failing
+    /// on the given index
+    inline Result<std::uint64_t, int> checksum(std::uint32_t record, std::uint32_t failing) {
+        if (record == failing) {
+            return Result<std::uint64_t, int>::Err(int(record));
+        }
+
+        std::uint64_t hash = record;
+        for (int round = 0; round < 32; ++round) {
+            hash = (hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ull;
+        }
+        return Result<std::uint64_t, int>::Ok(hash);
+    }
+
+    /// Sequential map stopping at the first error - the baseline of parallel_map
+    Result<std::vector<std::uint64_t>, int> checksum_loop(const std::vector<std::uint32_t>& records,
+                                                          std::uint32_t failing) {
+        std::vector<std::uint64_t> hashes;
+        hashes.reserve(records.size());
+        for (std::uint32_t record : records) {
+            auto hash = checksum(record, failing);
+            if (hash.is_err()) {
+                return Result<std::vector<std::uint64_t>, int>::Err(hash.unwrap_err());
+            }
+            hashes.push_back(hash.unwrap());
+        }
+
+        return Result<std::vector<std::uint64_t>, int>::Ok(std::move(hashes));
+    }
+
+    void parallel(Runner& runner) {
+        constexpr std::uint32_t size = 1u << 20;
+        constexpr std::uint32_t never = ~0u;
+        std::vector<std::uint32_t> records(size);
+        for (std::uint32_t i = 0; i < size; ++i) {
+            records[i] = i;
+        }
+
+        runner.run("parallel/map/loop", size, [&](std::size_t) {
+            do_not_optimize(checksum_loop(records, never).is_ok());
+        });
+        runner.run("parallel/map_early_err/loop", size, [&](std::size_t) {
+            do_not_optimize(checksum_loop(records, size / 16).is_ok());
+        });
+
+        for (unsigned threads : thread_counts()) {
+            const std::string suffix = "/" + std::to_string(threads) + "_threads";
+            question_mark::thread_pool pool(threads);
+
+            runner.run("parallel/map/parallel_map" + suffix, size, [&](std::size_t) {
+                do_not_optimize(question_mark::parallel_map(pool, records, [](std::uint32_t record) {
+                    return checksum(record, never);
+                }).is_ok());
+            });
+            runner.run("parallel/map_early_err/parallel_map" + suffix, size, [&](std::size_t) {
+                do_not_optimize(question_mark::parallel_map(pool, records, [](std::uint32_t record) {
+                    return checksum(record, size / 16);
+                }).is_ok());
+            });
+        }
+    }
+
+    void batches(Runner& runner) {
+        constexpr std::size_t size = std::size_t(1) << 20;
+        std::vector<Option<float>> readings;
+        std::vector<Option<float>> backups;
+        for (std::size_t i = 0; i < size; ++i) {
+            int value = table[i & table_mask];
+            readings.push_back(value < 0 ? Option<float>::None() : Option<float>::Some(float(value % 16)));
+            backups.push_back(i % 7 == 0 ? Option<float>::None() : Option<float>::Some(float(i)));
+        }
+        auto batch = question_mark::OptionVector<float>::from(readings);
+        auto backup = question_mark::OptionVector<float>::from(backups);
+        std::vector<float> values(size);
+        std::vector<Option<float>> options(size, Option<float>::None());
+
+        runner.run("batch/count_some/loop", size, [&](std::size_t) {
+            std::size_t count = 0;
+            for (const auto& reading : readings) {
+                count += reading.is_some();
+            }
+            do_not_optimize(count);
+        });
+        runner.run("batch/count_some/OptionVector", size, [&](std::size_t) {
+            do_not_optimize(batch.count_some());
+        });
+
+        runner.run("batch/unwrap_or/loop", size, [&](std::size_t) {
+            for (std::size_t i = 0; i < size; ++i) {
+                values[i] = readings[i].unwrap_or(-1.0f);
+            }
+            do_not_optimize(values.data());
+        });
+        runner.run("batch/unwrap_or/OptionVector", size, [&](std::size_t) {
+            do_not_optimize(batch.unwrap_or(-1.0f).data());
+        });
+
+        runner.run("batch/contains/loop", size, [&](std::size_t) {
+            std::size_t count = 0;
+            for (const auto& reading : readings) {
+                count += reading.contains(3.0f);
+            }
+            do_not_optimize(count);
+        });
+        runner.run("batch/contains/OptionVector", size, [&](std::size_t) {
+            do_not_optimize(batch.contains(3.0f).count());
+        });
+
+        runner.run("batch/map/loop", size, [&](std::size_t) {
+            for (std::size_t i = 0; i < size; ++i) {
+                options[i] = readings[i].map([](float value){return value * 0.5f + 1.0f;});
+            }
+            do_not_optimize(options.data());
+        });
+        runner.run("batch/map/OptionVector", size, [&](std::size_t) {
+            do_not_optimize(batch.map([](float value){return value * 0.5f + 1.0f;}).values().data());
+        });
+
+        runner.run("batch/or/loop", size, [&](std::size_t) {
+            for (std::size_t i = 0; i < size; ++i) {
+                options[i] = readings[i].or_(backups[i]);
+            }
+            do_not_optimize(options.data());
+        });
+        runner.run("batch/or/OptionVector", size, [&](std::size_t) {
+            do_not_optimize(batch.or_(backup).values().data());
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    for (std::size_t i = 0; i <= benchmarks::table_mask; ++i) {
+        benchmarks::table[i] = i % 4 == 0 ? -1 : int(i);
+    }
+
+    benchmarks::Runner runner(argc, argv);
+    benchmarks::construction(runner);
+    benchmarks::unwrapping(runner);
+    benchmarks::chaining(runner);
+    benchmarks::propagation(runner);
+    benchmarks::errors(runner);
+    benchmarks::sequences(runner);
+    benchmarks::trees(runner);
+    benchmarks::batches(runner);
+    benchmarks::handoffs(runner);
+    benchmarks::parallel(runner);
+
+    return runner.finish();
+}
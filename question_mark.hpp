@@ -1,151 +1,1253 @@
 #ifndef QUESTION_MARK_HEADER
 #define QUESTION_MARK_HEADER
 
-/// Mimic panic macro as exit with error code -1
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/// Panics are reported by a single out-of-line function kept away from the
+/// hot code, failure branches are laid out as unlikely
+#if defined(__GNUC__) || defined(__clang__)
+#define QUESTION_MARK_COLD __attribute__((cold, noinline))
+#define QUESTION_MARK_UNLIKELY(COND) __builtin_expect(!!(COND), 0)
+#elif defined(_MSC_VER)
+#define QUESTION_MARK_COLD __declspec(noinline)
+#define QUESTION_MARK_UNLIKELY(COND) (COND)
+#else
+#define QUESTION_MARK_COLD
+#define QUESTION_MARK_UNLIKELY(COND) (COND)
+#endif
+
+/// Mimic panic macro - calls the panic handler which never returns
 #ifndef PANIC
-#define PANIC(ERROR) {std::cout << "Program panicked! Error: " << ERROR << std::endl; exit(1);};
+#define PANIC(ERROR) ::question_mark::panic(ERROR)
+#endif
+
+/// Unchecked accessors verify their precondition through PANIC unless NDEBUG
+/// is defined, otherwise the optimizer is allowed to assume it holds
+#ifndef QUESTION_MARK_CHECK_UNCHECKED
+#ifdef NDEBUG
+#define QUESTION_MARK_CHECK_UNCHECKED 0
+#else
+#define QUESTION_MARK_CHECK_UNCHECKED 1
+#endif
+#endif
+
+#if QUESTION_MARK_CHECK_UNCHECKED
+#define QUESTION_MARK_ASSUME(COND, MESSAGE) if (QUESTION_MARK_UNLIKELY(!(COND))) { PANIC(MESSAGE); }
+#elif defined(__GNUC__) || defined(__clang__)
+#define QUESTION_MARK_ASSUME(COND, MESSAGE) if (!(COND)) { __builtin_unreachable(); }
+#elif defined(_MSC_VER)
+#define QUESTION_MARK_ASSUME(COND, MESSAGE) __assume(COND)
+#else
+#define QUESTION_MARK_ASSUME(COND, MESSAGE)
+#endif
+
+/// With QUESTION_MARK_TELEMETRY set, Err, None and failing unwraps count
+/// their call sites - see question_mark_telemetry.hpp. The call site is taken
+/// by an extra defaulted parameter, which is left out otherwise.
+#ifndef QUESTION_MARK_TELEMETRY
+#define QUESTION_MARK_TELEMETRY 0
+#endif
+
+#if QUESTION_MARK_TELEMETRY
+#include "question_mark_telemetry.hpp"
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define QUESTION_MARK_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#error "QUESTION_MARK_TELEMETRY needs __builtin_is_constant_evaluated"
+#endif
+#define QUESTION_MARK_SITE ::question_mark::telemetry::site site = ::question_mark::telemetry::site::current()
+#define QUESTION_MARK_AND_SITE , QUESTION_MARK_SITE
+#define QUESTION_MARK_AND_SITE_ARG , site
+#define QUESTION_MARK_SITE_ARG site
+#define QUESTION_MARK_RECORD(EVENT) (QUESTION_MARK_CONSTANT_EVALUATED() ? (void) 0 \
+    : ::question_mark::telemetry::record(site, ::question_mark::telemetry::event::EVENT))
+#else
+#define QUESTION_MARK_SITE
+#define QUESTION_MARK_AND_SITE
+#define QUESTION_MARK_AND_SITE_ARG
+#define QUESTION_MARK_SITE_ARG
+#define QUESTION_MARK_RECORD(EVENT) ((void) 0)
+#endif
+
+/// The backtrace_on_panic handler prints the stack where backtrace() exists
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define QUESTION_MARK_HAS_BACKTRACE 1
+#endif
+#endif
+#ifndef QUESTION_MARK_HAS_BACKTRACE
+#define QUESTION_MARK_HAS_BACKTRACE 0
+#endif
+
+/// Result can be used as a coroutine type with co_await propagating errors.
+/// The Result is taken from the coroutine's return object once the body
+/// finished, so only compilers known to convert that object after the body
+/// ran (GCC, Clang) get the support - others would panic on every call.
+#ifndef QUESTION_MARK_HAS_COROUTINES
+#if defined(__cpp_impl_coroutine) && defined(__has_include) && (defined(__GNUC__) || defined(__clang__))
+#if __has_include(<coroutine>)
+#define QUESTION_MARK_HAS_COROUTINES 1
+#endif
+#endif
+#endif
+#ifndef QUESTION_MARK_HAS_COROUTINES
+#define QUESTION_MARK_HAS_COROUTINES 0
+#endif
+
+#if QUESTION_MARK_HAS_COROUTINES
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "Result coroutines need a compiler converting the return object after the body finished (GCC, Clang)"
 #endif
+#include <coroutine>
+#endif
+
+/// Non-trivial payloads (constructors, destructors and switching union members)
+/// can be used in constant expressions since C++20
+#if defined(__cpp_constexpr_dynamic_alloc) && defined(__cpp_lib_constexpr_dynamic_alloc)
+#define QUESTION_MARK_HAS_CONSTEXPR_DYNAMIC_ALLOC 1
+#define QUESTION_MARK_CONSTEXPR20 constexpr
+#else
+#define QUESTION_MARK_HAS_CONSTEXPR_DYNAMIC_ALLOC 0
+#define QUESTION_MARK_CONSTEXPR20
+#endif
+
+template <typename T>
+class Option;
+
+template <typename T, typename E>
+class Result;
+
+namespace question_mark {
+
+/// Function called with the message of a panic. When it returns instead of
+/// exiting or throwing, the program is aborted.
+using panic_handler = void (*)(const char* message);
+
+/// Prints the message to the standard output and exits with code 1 - the default
+inline void exit_on_panic(const char* message) {
+    std::printf("Program panicked! Error: %s\n", message);
+    std::fflush(stdout);
+    std::exit(1);
+}
+
+/// Prints the message to the standard error and aborts
+inline void abort_on_panic(const char* message) {
+    std::fprintf(stderr, "Program panicked! Error: %s\n", message);
+    std::abort();
+}
+
+/// Exception thrown by throw_on_panic
+class panic_error : public std::logic_error {
+public:
+    using std::logic_error::logic_error;
+};
+
+/// Throws panic_error carrying the message, aborts when exceptions are disabled
+inline void throw_on_panic(const char* message) {
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+    throw panic_error(message);
+#else
+    abort_on_panic(message);
+#endif
+}
+
+/// Prints the message and the stack of the panicking thread to the standard
+/// error and aborts
+inline void backtrace_on_panic(const char* message) {
+    std::fprintf(stderr, "Program panicked! Error: %s\n", message);
+#if QUESTION_MARK_HAS_BACKTRACE
+    void* frames[64];
+    int count = ::backtrace(frames, 64);
+    ::backtrace_symbols_fd(frames, count, 2);
+#endif
+    std::abort();
+}
+
+namespace detail {
+
+inline std::atomic<panic_handler>& current_panic_handler() {
+    static std::atomic<panic_handler> handler(&exit_on_panic);
+    return handler;
+}
+
+} // namespace detail
+
+/// Replaces the handler of panics of all threads, returns the previous one.
+/// Null restores the default handler.
+inline panic_handler set_panic_handler(panic_handler handler) noexcept {
+    return detail::current_panic_handler().exchange(handler != nullptr ? handler : &exit_on_panic);
+}
+
+inline panic_handler get_panic_handler() noexcept {
+    return detail::current_panic_handler().load();
+}
+
+/// Reports a failed expect/unwrap through the panic handler
+[[noreturn]] QUESTION_MARK_COLD inline void panic(const char* message) {
+    get_panic_handler()(message);
+    std::abort();
+}
+
+[[noreturn]] QUESTION_MARK_COLD inline void panic(const std::string& message) {
+    panic(message.c_str());
+}
+
+/// Customization point describing a spare "none" representation of T.
+/// Specializations with has_niche set provide none() returning the sentinel
+/// and is_none() recognizing it, so Option<T> can store just the T and Result
+/// can drop its discriminant. They are meant for types whose sentinel is never
+/// a valid value - storing the sentinel as a value panics, so it can not turn
+/// into None. Object pointers and unique_ptrs use the address of a private
+/// object, so null stays a valid value of them.
+template <typename T, typename = void>
+struct option_traits {
+    static constexpr bool has_niche = false;
+};
+
+/// Traits using given constant as the none representation - convenient base
+/// for specializations of enums having a value never used as a valid one
+template <typename T, T Sentinel>
+struct sentinel_option_traits {
+    static constexpr bool has_niche = true;
+
+    static constexpr T none() noexcept {
+        return Sentinel;
+    }
+
+    static constexpr bool is_none(const T& value) noexcept {
+        return value == Sentinel;
+    }
+};
+
+namespace detail {
+
+/// Reference payload of Option<T&> or Result<T&, E&> kept as a pointer, so the
+/// storages deal with objects only. Never null unless it stands for none.
+template <typename T>
+class ref_holder {
+public:
+    constexpr explicit ref_holder(T& ref) noexcept : _ptr(&ref) {}
+
+    constexpr explicit ref_holder(std::nullptr_t) noexcept : _ptr(nullptr) {}
+
+    constexpr T& get() const noexcept {
+        return *_ptr;
+    }
+
+    constexpr bool is_null() const noexcept {
+        return _ptr == nullptr;
+    }
+
+private:
+    T* _ptr;
+};
+
+/// Address standing for none of object pointers - a private object, so no
+/// pointer the program stores can point to it
+template <typename U>
+U* none_pointer() noexcept {
+    alignas(std::max_align_t) static char marker;
+    return static_cast<U*>(static_cast<void*>(&marker));
+}
+
+/// Unique pointer payload of an Option or a Result. Holds none_pointer() when
+/// it stands for none and never deletes it - moves leave such a holder as it
+/// is, so moving from None keeps it None.
+template <typename T>
+class unique_ptr_holder : public std::unique_ptr<T> {
+public:
+    using base = std::unique_ptr<T>;
+
+    unique_ptr_holder(base&& ptr) noexcept : base(std::move(ptr)) {}
+
+    unique_ptr_holder(unique_ptr_holder&& other) noexcept
+        : base(other.is_marker() ? other.get() : other.release()) {}
+
+    unique_ptr_holder& operator= (unique_ptr_holder&& other) noexcept {
+        if (this != &other) {
+            auto ptr = other.is_marker() ? other.get() : other.release();
+            if (is_marker()) {
+                this->release();
+            }
+            base::reset(ptr);
+        }
+
+        return *this;
+    }
+
+    ~unique_ptr_holder() {
+        if (is_marker()) {
+            this->release();
+        }
+    }
+
+    static unique_ptr_holder none() noexcept {
+        return unique_ptr_holder(base(none_pointer<typename base::element_type>()));
+    }
+
+    bool is_marker() const noexcept {
+        return this->get() == none_pointer<typename base::element_type>();
+    }
+};
+
+/// Type kept in the storages for a payload of type T
+template <typename T>
+struct stored {
+    using type = T;
+};
+
+template <typename T>
+struct stored<T&> {
+    using type = ref_holder<T>;
+};
+
+template <typename T>
+struct stored<T&&> {
+    using type = ref_holder<T>;
+};
+
+template <typename T>
+struct stored<std::unique_ptr<T>> {
+    using type = unique_ptr_holder<T>;
+};
+
+template <typename T>
+using stored_t = typename stored<T>::type;
+
+/// Payload of given stored object - the referenced object for references
+template <typename T>
+constexpr T& stored_get(T& value) noexcept {
+    return value;
+}
+
+template <typename T>
+constexpr const T& stored_get(const T& value) noexcept {
+    return value;
+}
+
+template <typename T>
+constexpr T& stored_get(ref_holder<T>& value) noexcept {
+    return value.get();
+}
+
+template <typename T>
+constexpr T& stored_get(const ref_holder<T>& value) noexcept {
+    return value.get();
+}
+
+template <typename T>
+std::unique_ptr<T>& stored_get(unique_ptr_holder<T>& value) noexcept {
+    return value;
+}
+
+template <typename T>
+const std::unique_ptr<T>& stored_get(const unique_ptr_holder<T>& value) noexcept {
+    return value;
+}
+
+/// Read-only view of a payload of type T - references stay as they are
+template <typename T>
+using const_ref_t = typename std::conditional<std::is_reference<T>::value,
+    T, const T&>::type;
+
+/// Pointee of ranges over a payload of type T
+template <typename T>
+using pointee_t = typename std::remove_reference<T>::type;
+
+template <typename T>
+using const_pointee_t = typename std::conditional<std::is_reference<T>::value,
+    pointee_t<T>, const T>::type;
+
+} // namespace detail
+
+/// References are kept as pointers using nullptr as none, so Option<T&> is
+/// as large as a pointer
+template <typename T>
+struct option_traits<detail::ref_holder<T>> {
+    static constexpr bool has_niche = true;
+
+    static constexpr detail::ref_holder<T> none() noexcept {
+        return detail::ref_holder<T>(nullptr);
+    }
+
+    static constexpr bool is_none(const detail::ref_holder<T>& value) noexcept {
+        return value.is_null();
+    }
+};
+
+/// Object pointers use a private address as none, so Option<T*> is as large
+/// as a pointer and Some(nullptr) stays some
+template <typename T>
+struct option_traits<T*, typename std::enable_if<std::is_object<T>::value || std::is_void<T>::value>::type> {
+    static constexpr bool has_niche = true;
+
+    static T* none() noexcept {
+        return detail::none_pointer<T>();
+    }
+
+    static bool is_none(T* const& value) noexcept {
+        return value == detail::none_pointer<T>();
+    }
+};
+
+/// Unique pointers are kept in a holder using the same private address
+template <typename T>
+struct option_traits<detail::unique_ptr_holder<T>> {
+    static constexpr bool has_niche = true;
+
+    static detail::unique_ptr_holder<T> none() noexcept {
+        return detail::unique_ptr_holder<T>::none();
+    }
+
+    static bool is_none(const detail::unique_ptr_holder<T>& value) noexcept {
+        return value.is_marker();
+    }
+};
+
+namespace detail {
+
+/// Tag selecting the in-place constructors of the storage classes
+struct in_place_t {
+    explicit in_place_t() = default;
+};
+
+constexpr in_place_t in_place{};
+
+/// Tag selecting the error constructors of the Result's storage
+struct in_place_err_t {
+    explicit in_place_err_t() = default;
+};
+
+constexpr in_place_err_t in_place_err{};
+
+/// Constructs object at given address - usable in constant expressions when
+/// the standard library provides constexpr std::construct_at
+template <typename T, typename... Args>
+QUESTION_MARK_CONSTEXPR20 void construct_in_place(T* ptr, Args&&... args) {
+#if QUESTION_MARK_HAS_CONSTEXPR_DYNAMIC_ALLOC
+    std::construct_at(ptr, std::forward<Args>(args)...);
+#else
+    ::new (static_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+#endif
+}
+
+/// Decayed type returned by calling F with given arguments
+template <typename F, typename... Args>
+using call_result_t = typename std::decay<decltype(std::declval<F>()(std::declval<Args>()...))>::type;
+
+/// In-place storage of an Option's value: the value itself and an engaged flag.
+/// For trivially copyable payloads every special member stays trivial so the
+/// whole Option is trivially copyable and can be passed around in registers.
+template <typename T, bool = std::is_trivially_copyable<T>::value>
+struct option_storage {
+    constexpr option_storage() noexcept : _dummy(), _engaged(false) {}
+
+    template <typename... Args>
+    constexpr explicit option_storage(in_place_t, Args&&... args)
+        : _value(std::forward<Args>(args)...), _engaged(true) {}
+
+    template <typename... Args>
+    QUESTION_MARK_CONSTEXPR20 void construct(Args&&... args) {
+        construct_in_place(&_value, std::forward<Args>(args)...);
+        _engaged = true;
+    }
+
+    constexpr void reset() noexcept {
+        _engaged = false;
+    }
+
+    constexpr bool engaged() const noexcept {
+        return _engaged;
+    }
+
+    union {
+        char _dummy;
+        T _value;
+    };
+    bool _engaged;
+};
+
+/// In-place storage of an Option's value for payloads which need their
+/// constructors and destructor to be called
+template <typename T>
+struct option_storage<T, false> {
+    QUESTION_MARK_CONSTEXPR20 option_storage() noexcept : _engaged(false) {}
+
+    template <typename... Args>
+    QUESTION_MARK_CONSTEXPR20 explicit option_storage(in_place_t, Args&&... args)
+        : _value(std::forward<Args>(args)...), _engaged(true) {}
+
+    QUESTION_MARK_CONSTEXPR20 option_storage(const option_storage& other) : _engaged(false) {
+        if (other._engaged) {
+            construct(other._value);
+        }
+    }
+
+    QUESTION_MARK_CONSTEXPR20 option_storage(option_storage&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : _engaged(false) {
+        if (other._engaged) {
+            construct(std::move(other._value));
+        }
+    }
+
+    QUESTION_MARK_CONSTEXPR20 option_storage& operator= (const option_storage& other) {
+        if (_engaged && other._engaged) {
+            _value = other._value;
+        } else if (other._engaged) {
+            construct(other._value);
+        } else {
+            reset();
+        }
+
+        return *this;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 option_storage& operator= (option_storage&& other)
+            noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value) {
+        if (_engaged && other._engaged) {
+            _value = std::move(other._value);
+        } else if (other._engaged) {
+            construct(std::move(other._value));
+        } else {
+            reset();
+        }
+
+        return *this;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 ~option_storage() {
+        reset();
+    }
+
+    template <typename... Args>
+    QUESTION_MARK_CONSTEXPR20 void construct(Args&&... args) {
+        construct_in_place(&_value, std::forward<Args>(args)...);
+        _engaged = true;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 void reset() noexcept {
+        if (_engaged) {
+            _value.~T();
+            _engaged = false;
+        }
+    }
+
+    QUESTION_MARK_CONSTEXPR20 bool engaged() const noexcept {
+        return _engaged;
+    }
+
+    union {
+        T _value;
+    };
+    bool _engaged;
+};
+
+/// Panics when a payload stored in a niche storage is the sentinel, which
+/// would silently read back as the other alternative
+template <typename T>
+constexpr void check_not_sentinel(const T& value) {
+    if (QUESTION_MARK_UNLIKELY(option_traits<T>::is_none(value))) {
+        PANIC("Value equal to the none representation of its type can not be stored");
+    }
+}
+
+/// Storage of an Option whose payload has a niche - just the value, holding
+/// the sentinel of option_traits<T> when the option is none
+template <typename T>
+struct niche_option_storage {
+    using traits = option_traits<T>;
+
+    constexpr niche_option_storage() noexcept : _value(traits::none()) {}
+
+    template <typename... Args>
+    constexpr explicit niche_option_storage(in_place_t, Args&&... args)
+        : _value(std::forward<Args>(args)...) {
+        check_not_sentinel(_value);
+    }
+
+    template <typename... Args>
+    constexpr void construct(Args&&... args) {
+        _value = T(std::forward<Args>(args)...);
+        check_not_sentinel(_value);
+    }
+
+    constexpr void reset() noexcept {
+        _value = traits::none();
+    }
+
+    constexpr bool engaged() const noexcept {
+        return !traits::is_none(_value);
+    }
+
+    T _value;
+};
+
+template <typename T>
+using option_storage_t = typename std::conditional<
+    option_traits<T>::has_niche, niche_option_storage<T>, option_storage<T>>::type;
+
+/// In-place storage of a Result: union of the value and the error tagged with
+/// a single discriminant byte. Trivially copyable when both payloads are.
+template <typename T, typename E, bool = std::is_trivially_copyable<T>::value && std::is_trivially_copyable<E>::value>
+struct result_storage {
+    template <typename... Args>
+    constexpr explicit result_storage(in_place_t, Args&&... args)
+        : _ok(std::forward<Args>(args)...), _is_ok(true) {}
+
+    template <typename... Args>
+    constexpr explicit result_storage(in_place_err_t, Args&&... args)
+        : _err(std::forward<Args>(args)...), _is_ok(false) {}
+
+    constexpr bool is_ok() const noexcept {
+        return _is_ok;
+    }
+
+    constexpr T& ok() noexcept {
+        return _ok;
+    }
+
+    constexpr const T& ok() const noexcept {
+        return _ok;
+    }
+
+    constexpr E& err() noexcept {
+        return _err;
+    }
+
+    constexpr const E& err() const noexcept {
+        return _err;
+    }
+
+    union {
+        T _ok;
+        E _err;
+    };
+    bool _is_ok;
+};
+
+/// In-place storage of a Result for payloads which need their constructors
+/// and destructors to be called
+template <typename T, typename E>
+struct result_storage<T, E, false> {
+    template <typename... Args>
+    QUESTION_MARK_CONSTEXPR20 explicit result_storage(in_place_t, Args&&... args)
+        : _ok(std::forward<Args>(args)...), _is_ok(true) {}
+
+    template <typename... Args>
+    QUESTION_MARK_CONSTEXPR20 explicit result_storage(in_place_err_t, Args&&... args)
+        : _err(std::forward<Args>(args)...), _is_ok(false) {}
+
+    QUESTION_MARK_CONSTEXPR20 result_storage(const result_storage& other) : _is_ok(other._is_ok) {
+        if (_is_ok) {
+            construct_in_place(&_ok, other._ok);
+        } else {
+            construct_in_place(&_err, other._err);
+        }
+    }
+
+    QUESTION_MARK_CONSTEXPR20 result_storage(result_storage&& other)
+            noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_constructible<E>::value)
+        : _is_ok(other._is_ok) {
+        if (_is_ok) {
+            construct_in_place(&_ok, std::move(other._ok));
+        } else {
+            construct_in_place(&_err, std::move(other._err));
+        }
+    }
+
+    QUESTION_MARK_CONSTEXPR20 result_storage& operator= (const result_storage& other) {
+        if (_is_ok && other._is_ok) {
+            _ok = other._ok;
+        } else if (!_is_ok && !other._is_ok) {
+            _err = other._err;
+        } else if (other._is_ok) {
+            switch_to_ok(other._ok);
+        } else {
+            switch_to_err(other._err);
+        }
+
+        return *this;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 result_storage& operator= (result_storage&& other) noexcept(
+            std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value &&
+            std::is_nothrow_move_constructible<E>::value && std::is_nothrow_move_assignable<E>::value) {
+        if (_is_ok && other._is_ok) {
+            _ok = std::move(other._ok);
+        } else if (!_is_ok && !other._is_ok) {
+            _err = std::move(other._err);
+        } else if (other._is_ok) {
+            switch_to_ok(std::move(other._ok));
+        } else {
+            switch_to_err(std::move(other._err));
+        }
+
+        return *this;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 ~result_storage() {
+        destroy();
+    }
+
+    /// Replaces the error by a value built from given one. When building it
+    /// can throw, it is built aside before the error is destroyed, so a failed
+    /// assignment leaves the storage as it was.
+    template <typename U>
+    QUESTION_MARK_CONSTEXPR20 void switch_to_ok(U&& value) {
+        static_assert(std::is_nothrow_constructible<T, U&&>::value || std::is_nothrow_move_constructible<T>::value,
+            "Result assignment requires the value to be nothrow move constructible");
+        if (std::is_nothrow_constructible<T, U&&>::value) {
+            _err.~E();
+            construct_in_place(&_ok, std::forward<U>(value));
+        } else {
+            T built(std::forward<U>(value));
+            _err.~E();
+            construct_in_place(&_ok, std::move(built));
+        }
+        _is_ok = true;
+    }
+
+    /// Replaces the value by an error built from given one, see switch_to_ok
+    template <typename U>
+    QUESTION_MARK_CONSTEXPR20 void switch_to_err(U&& error) {
+        static_assert(std::is_nothrow_constructible<E, U&&>::value || std::is_nothrow_move_constructible<E>::value,
+            "Result assignment requires the error to be nothrow move constructible");
+        if (std::is_nothrow_constructible<E, U&&>::value) {
+            _ok.~T();
+            construct_in_place(&_err, std::forward<U>(error));
+        } else {
+            E built(std::forward<U>(error));
+            _ok.~T();
+            construct_in_place(&_err, std::move(built));
+        }
+        _is_ok = false;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 void destroy() noexcept {
+        if (_is_ok) {
+            _ok.~T();
+        } else {
+            _err.~E();
+        }
+    }
+
+    QUESTION_MARK_CONSTEXPR20 bool is_ok() const noexcept {
+        return _is_ok;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 T& ok() noexcept {
+        return _ok;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 const T& ok() const noexcept {
+        return _ok;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 E& err() noexcept {
+        return _err;
+    }
+
+    QUESTION_MARK_CONSTEXPR20 const E& err() const noexcept {
+        return _err;
+    }
+
+    union {
+        T _ok;
+        E _err;
+    };
+    bool _is_ok;
+};
+
+/// Result storage without discriminant for a value with a niche and an empty
+/// error - only the value is stored and its sentinel marks the error
+template <typename T, typename E>
+struct niche_ok_result_storage : private E {
+    using traits = option_traits<T>;
+
+    template <typename... Args>
+    constexpr explicit niche_ok_result_storage(in_place_t, Args&&... args)
+        : E(), _ok(std::forward<Args>(args)...) {
+        check_not_sentinel(_ok);
+    }
+
+    template <typename... Args>
+    constexpr explicit niche_ok_result_storage(in_place_err_t, Args&&... args)
+        : E(std::forward<Args>(args)...), _ok(traits::none()) {}
+
+    constexpr bool is_ok() const noexcept {
+        return !traits::is_none(_ok);
+    }
+
+    constexpr T& ok() noexcept {
+        return _ok;
+    }
+
+    constexpr const T& ok() const noexcept {
+        return _ok;
+    }
+
+    constexpr E& err() noexcept {
+        return *this;
+    }
+
+    constexpr const E& err() const noexcept {
+        return *this;
+    }
+
+    T _ok;
+};
+
+/// Result storage without discriminant for an empty value and an error with
+/// a niche - only the error is stored and its sentinel marks the success
+template <typename T, typename E>
+struct niche_err_result_storage : private T {
+    using traits = option_traits<E>;
+
+    template <typename... Args>
+    constexpr explicit niche_err_result_storage(in_place_t, Args&&... args)
+        : T(std::forward<Args>(args)...), _err(traits::none()) {}
+
+    template <typename... Args>
+    constexpr explicit niche_err_result_storage(in_place_err_t, Args&&... args)
+        : T(), _err(std::forward<Args>(args)...) {
+        check_not_sentinel(_err);
+    }
+
+    constexpr bool is_ok() const noexcept {
+        return traits::is_none(_err);
+    }
+
+    constexpr T& ok() noexcept {
+        return *this;
+    }
+
+    constexpr const T& ok() const noexcept {
+        return *this;
+    }
+
+    constexpr E& err() noexcept {
+        return _err;
+    }
+
+    constexpr const E& err() const noexcept {
+        return _err;
+    }
+
+    E _err;
+};
+
+/// Checks if T carries no data and can be recreated on demand, so a Result
+/// can keep it as an empty base next to the other alternative
+template <typename T>
+struct is_empty_alternative : std::integral_constant<bool,
+    std::is_empty<T>::value && !std::is_final<T>::value && std::is_default_constructible<T>::value> {};
+
+template <typename T, typename E>
+using result_storage_t = typename std::conditional<
+    option_traits<T>::has_niche && is_empty_alternative<E>::value,
+    niche_ok_result_storage<T, E>,
+    typename std::conditional<
+        is_empty_alternative<T>::value && option_traits<E>::has_niche,
+        niche_err_result_storage<T, E>,
+        result_storage<T, E>>::type>::type;
+
+/// Range of zero or one payloads of an Option or a Result - iterated as a
+/// pair of pointers into the storage
+template <typename T>
+class payload_range {
+public:
+    using value_type = typename std::remove_const<T>::type;
+    using iterator = T*;
+
+    constexpr explicit payload_range(T* value) noexcept
+        : _begin(value), _end(value == nullptr ? value : value + 1) {}
+
+    constexpr T* begin() const noexcept {
+        return _begin;
+    }
+
+    constexpr T* end() const noexcept {
+        return _end;
+    }
+
+    constexpr std::size_t size() const noexcept {
+        return _begin == _end ? 0 : 1;
+    }
+
+    constexpr bool empty() const noexcept {
+        return _begin == _end;
+    }
+
+private:
+    T* _begin;
+    T* _end;
+};
+
+/// Creates None and Err for the library itself through the private
+/// constructors, so only the factories called by the user record telemetry
+struct factory {
+    template <typename O>
+    static constexpr O none() {
+        return O();
+    }
+
+    template <typename R, typename F>
+    static constexpr R err(F&& error) {
+        return R(in_place_err, std::forward<F>(error));
+    }
+};
+
+template <typename T>
+constexpr Option<T> make_none() {
+    return factory::none<Option<T>>();
+}
+
+template <typename T, typename E, typename F>
+constexpr Result<T, E> make_err(F&& error) {
+    return factory::err<Result<T, E>>(std::forward<F>(error));
+}
+
+} // namespace detail
+} // namespace question_mark
+
+/// Option class containing value or none
+template <typename T>
+class Option {
+public:
+    /// Creates option containing value
+    static constexpr Option Some(T value) {
+        return Option(question_mark::detail::in_place, std::forward<T>(value));
+    }
+
+    /// Creates option containing value moved out of given pointer
+    /// or none when pointer is empty
+    static Option Some(std::unique_ptr<question_mark::detail::pointee_t<T>> ptr QUESTION_MARK_AND_SITE) {
+        static_assert(!std::is_reference<T>::value, "Option of a reference can not own the pointed value");
+        if (ptr == nullptr) {
+            return None(QUESTION_MARK_SITE_ARG);
+        }
+
+        return Some(std::move(*ptr));
+    }
+
+    /// Creates option containing none
+    static constexpr Option None(QUESTION_MARK_SITE) {
+        QUESTION_MARK_RECORD(none);
+        return Option();
+    }
+
+    /// Checks if option contains value
+    constexpr bool is_some() const {
+        return _storage.engaged();
+    }
+
+    /// Checks if option contains none
+    constexpr bool is_none() const {
+        return !_storage.engaged();
+    }
+
+    /// Checks if option contains given value
+    constexpr bool contains(const question_mark::detail::pointee_t<T>& value) const {
+        if (is_some()) {
+            return get() == value;
+        }
+
+        return false;
+    }
+
+    /// Returns copy of contained value or panic with given message
+    /// when value is none
+    constexpr T expect(const char* msg QUESTION_MARK_AND_SITE) const& {
+        if (QUESTION_MARK_UNLIKELY(is_none())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC(msg);
+        }
+
+        return get();
+    }
+
+    /// Returns contained value moved out of the option or panic with
+    /// given message when value is none
+    constexpr T expect(const char* msg QUESTION_MARK_AND_SITE) && {
+        if (QUESTION_MARK_UNLIKELY(is_none())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC(msg);
+        }
+
+        return std::forward<T>(get());
+    }
+
+    constexpr T expect(const std::string& msg QUESTION_MARK_AND_SITE) const& {
+        return expect(msg.c_str() QUESTION_MARK_AND_SITE_ARG);
+    }
+
+    constexpr T expect(const std::string& msg QUESTION_MARK_AND_SITE) && {
+        return std::move(*this).expect(msg.c_str() QUESTION_MARK_AND_SITE_ARG);
+    }
+
+    /// Returns copy of contained value or panic when value is none
+    constexpr T unwrap(QUESTION_MARK_SITE) const& {
+        if (QUESTION_MARK_UNLIKELY(is_none())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC("Option::unwrap() called on a None");
+        }
+
+        return get();
+    }
+
+    /// Returns contained value moved out of the option or panic when
+    /// value is none
+    constexpr T unwrap(QUESTION_MARK_SITE) && {
+        if (QUESTION_MARK_UNLIKELY(is_none())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC("Option::unwrap() called on a None");
+        }
+
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained value without checking that it exists - the
+    /// check is made only when QUESTION_MARK_CHECK_UNCHECKED is set
+    constexpr T unwrap_unchecked() const& {
+        QUESTION_MARK_ASSUME(is_some(), "Option::unwrap_unchecked() called on a None");
+        return get();
+    }
+
+    /// Returns contained value moved out of the option without checking that
+    /// it exists
+    constexpr T unwrap_unchecked() && {
+        QUESTION_MARK_ASSUME(is_some(), "Option::unwrap_unchecked() called on a None");
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained value without checking that it exists,
+    /// given message is reported when the check is made
+    constexpr T expect_unchecked(const char* msg) const& {
+        QUESTION_MARK_ASSUME(is_some(), msg);
+        return get();
+    }
+
+    /// Returns contained value moved out of the option without checking that
+    /// it exists, given message is reported when the check is made
+    constexpr T expect_unchecked(const char* msg) && {
+        QUESTION_MARK_ASSUME(is_some(), msg);
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained value or use given if not exists
+    constexpr T unwrap_or(T value) const& {
+        if (is_none()) {
+            return value;
+        }
+
+        return get();
+    }
+
+    /// Returns contained value moved out of the option or use given
+    /// if not exists
+    constexpr T unwrap_or(T value) && {
+        if (is_none()) {
+            return value;
+        }
 
-#include <memory>
+        return std::forward<T>(get());
+    }
 
-template <typename T, typename E>
-class Result;
+    /// Returns copy of contained value or calls given function and takes
+    /// him value
+    template<typename F>
+    constexpr T unwrap_or_else(F&& fn) const& {
+        if (is_none()) {
+            return fn();
+        }
 
-/// Option class containing value or none
-template <typename T>
-class Option {
-public:
-    /// Creates option containing value
-    static Option Some(T value) {
-        return Some(std::make_unique<T>(value));
+        return get();
     }
 
-    /// Creates option containing value
-    static Option Some(std::unique_ptr<T> ptr) {
-        return Option(std::move(ptr));
+    /// Returns contained value moved out of the option or calls given
+    /// function and takes him value
+    template<typename F>
+    constexpr T unwrap_or_else(F&& fn) && {
+        if (is_none()) {
+            return fn();
+        }
+
+        return std::forward<T>(get());
     }
 
-    /// Creates option containing none
-    static Option None() {
-        return Option(nullptr);
+    /// Takes the value out of the option leaving none in its place
+    constexpr Option take() {
+        Option taken = std::move(*this);
+        _storage.reset();
+        return taken;
     }
 
-    /// Checks if option contains value
-    bool is_some() const {
-        return _some != nullptr;
+    /// Puts given value into the option and returns the previous one
+    QUESTION_MARK_CONSTEXPR20 Option replace(T value) {
+        Option previous = take();
+        _storage.construct(std::forward<T>(value));
+        return previous;
     }
 
-    /// Checks if option contains none
-    bool is_none() const {
-        return _some == nullptr;
+    /// Returns range over the contained value - empty when value is none
+    constexpr question_mark::detail::payload_range<question_mark::detail::const_pointee_t<T>> iter() const& {
+        return question_mark::detail::payload_range<question_mark::detail::const_pointee_t<T>>(is_some() ? &get() : nullptr);
     }
 
-    /// Checks if option contains given value
-    bool contains(T value) const {
-        if (is_some()) {
-            return *_some == value;
+    /// Returns range over the contained value allowing to modify it in place
+    constexpr question_mark::detail::payload_range<question_mark::detail::pointee_t<T>> iter() & {
+        return question_mark::detail::payload_range<question_mark::detail::pointee_t<T>>(is_some() ? &get() : nullptr);
+    }
+
+    /// Iterating a temporary would leave the range dangling
+    void iter() && = delete;
+
+    /// Returns option borrowing the contained value
+    constexpr Option<question_mark::detail::const_ref_t<T>> as_ref() const& {
+        if (is_none()) {
+            return question_mark::detail::make_none<question_mark::detail::const_ref_t<T>>();
         }
 
-        return false;
+        return Option<question_mark::detail::const_ref_t<T>>::Some(get());
     }
 
-    /// Returns contained value or panic with given message
-    /// when value is none
-    T expect(const std::string& msg) const {
+    /// Returns option borrowing the contained value for modification
+    constexpr Option<question_mark::detail::pointee_t<T>&> as_mut() & {
         if (is_none()) {
-            PANIC(msg);
+            return question_mark::detail::make_none<question_mark::detail::pointee_t<T>&>();
         }
 
-        return T(*_some);
+        return Option<question_mark::detail::pointee_t<T>&>::Some(get());
     }
 
-    /// Returns contained value or panic when value is none
-    T unwrap() const {
+    /// Borrowing a temporary would leave the option dangling
+    void as_ref() && = delete;
+    void as_mut() && = delete;
+
+    /// Maps an Option<T> to Option<U> by applying a function to a borrowed
+    /// contained value or panic on no data;
+    template<typename F, typename U = question_mark::detail::call_result_t<F&, const T&>>
+    constexpr Option<U> map(F&& fn) const& {
         if (is_none()) {
-            PANIC("Option::unwrap() called on a None");
+            return question_mark::detail::make_none<U>();
         }
 
-        return T(*_some);
+        return Option<U>::Some(fn(get()));
     }
 
-    /// Returns contained value or use given if not exists
-    T unwrap_or(T value) const {
+    /// Maps an Option<T> to Option<U> by applying a function to a contained
+    /// value moved out of the option or panic on no data;
+    template<typename F, typename U = question_mark::detail::call_result_t<F&, T&&>>
+    constexpr Option<U> map(F&& fn) && {
         if (is_none()) {
-            return value;
+            return question_mark::detail::make_none<U>();
         }
 
-        return T(*_some);
+        return Option<U>::Some(fn(std::forward<T>(get())));
     }
 
-    /// Returns contained value or calls given function and takes
-    /// him value
-    T unwrap_or_else(std::function<T(void)> fn) const {
+    /// Maps an Option<T> to Option<U> by applying a function to a borrowed
+    /// contained value or use given if data not exists.
+    template<typename U, typename F>
+    constexpr Option<U> map_or(U value, F&& fn) const& {
         if (is_none()) {
-            return fn();
+            return Option<U>::Some(std::move(value));
         }
 
-        return T(*_some);
+        return Option<U>::Some(fn(get()));
     }
 
-    /// Maps an Option<T> to Option<U> by applying a function to a contained value
-    /// or panic on no data;
-    template<typename U>
-    Option<U> map(std::function<U(T)> fn) const {
+    /// Maps an Option<T> to Option<U> by applying a function to a contained
+    /// value moved out of the option or use given if data not exists.
+    template<typename U, typename F>
+    constexpr Option<U> map_or(U value, F&& fn) && {
         if (is_none()) {
-            return Option<U>::None();
+            return Option<U>::Some(std::move(value));
         }
 
-        return Option<U>::Some(fn(*_some));
+        return Option<U>::Some(fn(std::forward<T>(get())));
     }
 
-    /// Maps an Option<T> to Option<U> by applying a function to a contained value
-    /// or use given if data not exists.
-    template<typename U>
-    Option<U> map_or(U value, std::function<U(T)> fn) const {
+    /// Maps an Option<T> to Option<U> by applying a function to a borrowed
+    /// contained value or use default function given.
+    template<typename D, typename F, typename U = question_mark::detail::call_result_t<F&, const T&>>
+    constexpr Option<U> map_or_else(D&& fn_else, F&& fn) const& {
         if (is_none()) {
-            return Option<U>::Some(value);
+            return Option<U>::Some(fn_else());
         }
 
-        return Option<U>::Some(fn(*_some));
+        return Option<U>::Some(fn(get()));
     }
 
-    /// Maps an Option<T> to Option<U> by applying a function to a contained value
-    /// or use default function given.
-    template<typename U>
-    Option<U> map_or_else(std::function<U(void)> fn_else, std::function<U(T)> fn) const {
+    /// Maps an Option<T> to Option<U> by applying a function to a contained
+    /// value moved out of the option or use default function given.
+    template<typename D, typename F, typename U = question_mark::detail::call_result_t<F&, T&&>>
+    constexpr Option<U> map_or_else(D&& fn_else, F&& fn) && {
         if (is_none()) {
             return Option<U>::Some(fn_else());
         }
 
-        return Option<U>::Some(fn(*_some));
+        return Option<U>::Some(fn(std::forward<T>(get())));
     }
 
-    /// Returns Result with contained value or Error with the given one
+    /// Returns Result with copy of contained value or Error with the given one
     template<typename E>
-    Result<T, E> ok_or(E value) {
+    constexpr Result<T, E> ok_or(E value) const& {
         if (is_none()) {
-            return Result<T, E>::Err(value);
+            return question_mark::detail::make_err<T, E>(std::move(value));
         }
 
-        return Result<T, E>::Ok(*_some);
+        return Result<T, E>::Ok(get());
     }
 
-    /// Returns Result with contained value or calls given function
-    /// and returns result
+    /// Returns Result with contained value moved out of the option
+    /// or Error with the given one
     template<typename E>
-    Result<T, E> ok_or_else(std::function<E(void)> fn) {
+    constexpr Result<T, E> ok_or(E value) && {
+        if (is_none()) {
+            return question_mark::detail::make_err<T, E>(std::move(value));
+        }
+
+        return Result<T, E>::Ok(std::forward<T>(get()));
+    }
+
+    /// Returns Result with copy of contained value or calls given function
+    /// and returns result
+    template<typename F, typename E = question_mark::detail::call_result_t<F&>>
+    constexpr Result<T, E> ok_or_else(F&& fn) const& {
+        if (is_none()) {
+            return question_mark::detail::make_err<T, E>(fn());
+        }
+
+        return Result<T, E>::Ok(get());
+    }
+
+    /// Returns Result with contained value moved out of the option
+    /// or calls given function and returns result
+    template<typename F, typename E = question_mark::detail::call_result_t<F&>>
+    constexpr Result<T, E> ok_or_else(F&& fn) && {
         if (is_none()) {
-            return Result<T, E>::Err(fn());
+            return question_mark::detail::make_err<T, E>(fn());
         }
 
-        return Result<T, E>::Ok(*_some);
+        return Result<T, E>::Ok(std::forward<T>(get()));
     }
 
     /// Returns None if the option is None, otherwise returns given value.
     template<typename E>
-    Option<E> and_(Option<E> value) {
+    constexpr Option<E> and_(Option<E> value) const {
         if (is_none()) {
-            return Option<E>::None();
+            return question_mark::detail::make_none<E>();
         }
 
         return value;
@@ -153,140 +1255,609 @@ public:
 
     /// Returns None if the option is None or calls given function
     /// and returns result as Option
-    template<typename E>
-    Option<E> and_then(std::function<Option<E>(void)> fn) {
+    template<typename F, typename R = question_mark::detail::call_result_t<F&>>
+    constexpr R and_then(F&& fn) const {
         if (is_none()) {
-            return Option<E>::None();
+            return question_mark::detail::factory::none<R>();
         }
 
         return fn();
     }
 
+    /// Returns None if the option is None or filters borrowed value with
+    /// given function - if result of predicates returns true it returns
+    /// option with copy of data
+    template<typename F>
+    constexpr Option<T> filter(F&& fn) const& {
+        if (is_none() || !fn(get())) {
+            return Option();
+        }
+
+        return *this;
+    }
+
     /// Returns None if the option is None or filters value with
     /// given function - if result of predicates returns true it returns
-    /// option with data
-    Option<T> filter(std::function<bool(T)> fn) {
-        if (is_none() || !fn(*_some)) {
-            return None();
+    /// option with data moved out of this one
+    template<typename F>
+    constexpr Option<T> filter(F&& fn) && {
+        if (is_none() || !fn(get())) {
+            return Option();
         }
 
-        return Some(*_some);
+        return std::move(*this);
     }
 
-    /// Returns data if the option is not None, otherwise returns given value.
+    /// Returns copy of data if the option is not None, otherwise returns given value.
     template<typename E>
-    Option<E> or_(Option<E> value) {
+    constexpr Option<E> or_(Option<E> value) const& {
         if (is_none()) {
             return value;
         }
 
-        return Some(*_some);
+        return *this;
     }
 
-    /// Returns value if is not None or calls given function
-    /// and returns result as Option
+    /// Returns data moved out of the option if it is not None, otherwise
+    /// returns given value.
     template<typename E>
-    Option<E> or_else(std::function<Option<E>(void)> fn) {
+    constexpr Option<E> or_(Option<E> value) && {
+        if (is_none()) {
+            return value;
+        }
+
+        return std::move(*this);
+    }
+
+    /// Returns copy of value if is not None or calls given function
+    /// and returns result as Option
+    template<typename F, typename R = question_mark::detail::call_result_t<F&>>
+    constexpr R or_else(F&& fn) const& {
         if (is_none()) {
             return fn();
         }
 
-        return Some(*_some);
+        return *this;
     }
 
-    /// Returns Some with data if exactly one of value or data is not None or
-    /// returns None
+    /// Returns value moved out of the option if is not None or calls
+    /// given function and returns result as Option
+    template<typename F, typename R = question_mark::detail::call_result_t<F&>>
+    constexpr R or_else(F&& fn) && {
+        if (is_none()) {
+            return fn();
+        }
+
+        return std::move(*this);
+    }
+
+    /// Returns Some with copy of data if exactly one of value or data is
+    /// not None or returns None
+    template<typename E>
+    constexpr Option<E> xor_(Option<E> value) const& {
+        if (is_some() && value.is_none()) {
+            return *this;
+        }
+
+        if (is_none() && value.is_some()) {
+            return value;
+        }
+
+        return Option();
+    }
+
+    /// Returns Some with data moved out of the option if exactly one of
+    /// value or data is not None or returns None
     template<typename E>
-    Option<E> xor_(Option<E> value) {
+    constexpr Option<E> xor_(Option<E> value) && {
         if (is_some() && value.is_none()) {
-            return Some(*_some);
+            return std::move(*this);
         }
 
         if (is_none() && value.is_some()) {
             return value;
         }
 
-        return None();
+        return Option();
     }
 
-    bool operator== (const Option<T>& other) const {
+    constexpr bool operator== (const Option<T>& other) const {
         if (is_none() || other.is_none()) {
             return is_none() && other.is_none();
         }
 
-        return *_some == *other._some;
+        return get() == other.get();
     }
 
 private:
-    explicit Option(std::unique_ptr<T> value) {
-        this->_some = std::move(value);
+    friend struct question_mark::detail::factory;
+
+    constexpr Option() = default;
+
+    template <typename... Args>
+    constexpr explicit Option(question_mark::detail::in_place_t tag, Args&&... args)
+        : _storage(tag, std::forward<Args>(args)...) {}
+
+    /// Contained value - the referenced object for reference payloads
+    constexpr T& get() noexcept {
+        return question_mark::detail::stored_get(_storage._value);
+    }
+
+    constexpr question_mark::detail::const_ref_t<T> get() const noexcept {
+        return question_mark::detail::stored_get(_storage._value);
     }
 
-    std::unique_ptr<T> _some;
+    question_mark::detail::option_storage_t<question_mark::detail::stored_t<T>> _storage;
 };
 
+namespace question_mark {
+namespace detail {
+
+#if QUESTION_MARK_HAS_COROUTINES
+template <typename T, typename E>
+struct result_promise;
+
+template <typename T, typename E>
+class result_return_object;
+
+template <typename T, typename E>
+struct result_awaiter;
+#endif
+
+} // namespace detail
+} // namespace question_mark
+
 /// Result class containing data on successful or error
 template <typename T, typename E>
 class Result {
 public:
     /// Creates successful result with some data
-    static Result Ok(T value) {
-        return Result(std::make_unique<T>(value), nullptr);
+    static constexpr Result Ok(T value) {
+        return Result(question_mark::detail::in_place, std::forward<T>(value));
     }
 
     /// Creates result containing error
-    static Result Err(E error) {
-        return Result(nullptr, std::make_unique<E>(error));
+    static constexpr Result Err(E error QUESTION_MARK_AND_SITE) {
+        QUESTION_MARK_RECORD(err);
+        return Result(question_mark::detail::in_place_err, std::forward<E>(error));
     }
 
     /// Checks if result containing some data
-    bool is_ok() const {
-        return _ok != nullptr;
+    constexpr bool is_ok() const {
+        return _storage.is_ok();
     }
 
     /// Checks if result containing error
-    bool is_err() const {
-        return _err != nullptr;
+    constexpr bool is_err() const {
+        return !_storage.is_ok();
     }
 
     /// Checks if results containing given value
-    bool contains(T value) {
+    constexpr bool contains(const question_mark::detail::pointee_t<T>& value) const {
         if (is_ok()) {
-            return *_ok == value;
+            return get() == value;
         }
 
         return false;
     }
 
     /// Checks if results containing given error
-    bool contains_err(E error) {
+    constexpr bool contains_err(const question_mark::detail::pointee_t<E>& error) const {
         if (is_err()) {
-            return *_err == error;
+            return get_err() == error;
         }
 
         return false;
     }
 
-    bool operator== (const Result<T, E>& other) const {
+    /// Converts result into Option containing copy of the data or None on error
+    constexpr Option<T> ok() const& {
+        if (is_err()) {
+            return question_mark::detail::make_none<T>();
+        }
+
+        return Option<T>::Some(get());
+    }
+
+    /// Converts result into Option containing data moved out of the result
+    /// or None on error
+    constexpr Option<T> ok() && {
+        if (is_err()) {
+            return question_mark::detail::make_none<T>();
+        }
+
+        return Option<T>::Some(std::forward<T>(get()));
+    }
+
+    /// Converts result into Option containing copy of the error or None
+    /// on success
+    constexpr Option<E> err() const& {
+        if (is_ok()) {
+            return question_mark::detail::make_none<E>();
+        }
+
+        return Option<E>::Some(get_err());
+    }
+
+    /// Converts result into Option containing error moved out of the result
+    /// or None on success
+    constexpr Option<E> err() && {
+        if (is_ok()) {
+            return question_mark::detail::make_none<E>();
+        }
+
+        return Option<E>::Some(std::forward<E>(get_err()));
+    }
+
+    /// Returns range over the contained data - empty on error
+    constexpr question_mark::detail::payload_range<question_mark::detail::const_pointee_t<T>> iter() const& {
+        return question_mark::detail::payload_range<question_mark::detail::const_pointee_t<T>>(is_ok() ? &get() : nullptr);
+    }
+
+    /// Returns range over the contained data allowing to modify it in place
+    constexpr question_mark::detail::payload_range<question_mark::detail::pointee_t<T>> iter() & {
+        return question_mark::detail::payload_range<question_mark::detail::pointee_t<T>>(is_ok() ? &get() : nullptr);
+    }
+
+    /// Iterating a temporary would leave the range dangling
+    void iter() && = delete;
+
+    /// Returns result borrowing the contained data or error
+    constexpr Result<question_mark::detail::const_ref_t<T>, question_mark::detail::const_ref_t<E>> as_ref() const& {
+        using borrowed = Result<question_mark::detail::const_ref_t<T>, question_mark::detail::const_ref_t<E>>;
+        if (is_err()) {
+            return question_mark::detail::factory::err<borrowed>(get_err());
+        }
+
+        return borrowed::Ok(get());
+    }
+
+    /// Returns result borrowing the contained data or error for modification
+    constexpr Result<question_mark::detail::pointee_t<T>&, question_mark::detail::pointee_t<E>&> as_mut() & {
+        using borrowed = Result<question_mark::detail::pointee_t<T>&, question_mark::detail::pointee_t<E>&>;
+        if (is_err()) {
+            return question_mark::detail::factory::err<borrowed>(get_err());
+        }
+
+        return borrowed::Ok(get());
+    }
+
+    /// Borrowing a temporary would leave the result dangling
+    void as_ref() && = delete;
+    void as_mut() && = delete;
+
+    /// Returns copy of contained data or panic with given message on error
+    constexpr T expect(const char* msg QUESTION_MARK_AND_SITE) const& {
+        if (QUESTION_MARK_UNLIKELY(is_err())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC(msg);
+        }
+
+        return get();
+    }
+
+    /// Returns data moved out of the result or panic with given message
+    /// on error
+    constexpr T expect(const char* msg QUESTION_MARK_AND_SITE) && {
+        if (QUESTION_MARK_UNLIKELY(is_err())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC(msg);
+        }
+
+        return std::forward<T>(get());
+    }
+
+    constexpr T expect(const std::string& msg QUESTION_MARK_AND_SITE) const& {
+        return expect(msg.c_str() QUESTION_MARK_AND_SITE_ARG);
+    }
+
+    constexpr T expect(const std::string& msg QUESTION_MARK_AND_SITE) && {
+        return std::move(*this).expect(msg.c_str() QUESTION_MARK_AND_SITE_ARG);
+    }
+
+    /// Returns copy of contained data or panic on error
+    constexpr T unwrap(QUESTION_MARK_SITE) const& {
+        if (QUESTION_MARK_UNLIKELY(is_err())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC("Result::unwrap() called on an Err");
+        }
+
+        return get();
+    }
+
+    /// Returns data moved out of the result or panic on error
+    constexpr T unwrap(QUESTION_MARK_SITE) && {
+        if (QUESTION_MARK_UNLIKELY(is_err())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC("Result::unwrap() called on an Err");
+        }
+
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained data without checking for an error - the
+    /// check is made only when QUESTION_MARK_CHECK_UNCHECKED is set
+    constexpr T unwrap_unchecked() const& {
+        QUESTION_MARK_ASSUME(is_ok(), "Result::unwrap_unchecked() called on an Err");
+        return get();
+    }
+
+    /// Returns data moved out of the result without checking for an error
+    constexpr T unwrap_unchecked() && {
+        QUESTION_MARK_ASSUME(is_ok(), "Result::unwrap_unchecked() called on an Err");
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained data without checking for an error, given
+    /// message is reported when the check is made
+    constexpr T expect_unchecked(const char* msg) const& {
+        QUESTION_MARK_ASSUME(is_ok(), msg);
+        return get();
+    }
+
+    /// Returns data moved out of the result without checking for an error,
+    /// given message is reported when the check is made
+    constexpr T expect_unchecked(const char* msg) && {
+        QUESTION_MARK_ASSUME(is_ok(), msg);
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained data or given value on error
+    constexpr T unwrap_or(T value) const& {
+        if (is_err()) {
+            return value;
+        }
+
+        return get();
+    }
+
+    /// Returns data moved out of the result or given value on error
+    constexpr T unwrap_or(T value) && {
+        if (is_err()) {
+            return value;
+        }
+
+        return std::forward<T>(get());
+    }
+
+    /// Returns copy of contained error or panic on success
+    constexpr E unwrap_err(QUESTION_MARK_SITE) const& {
+        if (QUESTION_MARK_UNLIKELY(is_ok())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC("Result::unwrap_err() called on an Ok");
+        }
+
+        return get_err();
+    }
+
+    /// Returns error moved out of the result or panic on success
+    constexpr E unwrap_err(QUESTION_MARK_SITE) && {
+        if (QUESTION_MARK_UNLIKELY(is_ok())) {
+            QUESTION_MARK_RECORD(panic);
+            PANIC("Result::unwrap_err() called on an Ok");
+        }
+
+        return std::forward<E>(get_err());
+    }
+
+#if QUESTION_MARK_HAS_COROUTINES
+    using promise_type = question_mark::detail::result_promise<T, E>;
+
+    /// Awaits result moved into the coroutine - resumes it with the data
+    /// or finishes it returning the error
+    question_mark::detail::result_awaiter<T, E> operator co_await() && {
+        return {std::move(*this)};
+    }
+
+    /// Awaits copy of the result - resumes coroutine with the data or
+    /// finishes it returning the error
+    question_mark::detail::result_awaiter<T, E> operator co_await() const& {
+        return {*this};
+    }
+#endif
+
+    constexpr bool operator== (const Result<T, E>& other) const {
         if (is_ok() && other.is_ok()) {
-            return *_ok == *other._ok;
+            return get() == other.get();
         } else if (is_err() && other.is_err()) {
-            return *_err == *other._err;
+            return get_err() == other.get_err();
         }
 
         return false;
     }
 
 private:
-    Result(std::unique_ptr<T> ok, std::unique_ptr<E> err) {
-        this->_ok = std::move(ok);
-        this->_err = std::move(err);
+    friend struct question_mark::detail::factory;
+
+    template <typename... Args>
+    constexpr explicit Result(question_mark::detail::in_place_t tag, Args&&... args)
+        : _storage(tag, std::forward<Args>(args)...) {}
+
+    template <typename... Args>
+    constexpr explicit Result(question_mark::detail::in_place_err_t tag, Args&&... args)
+        : _storage(tag, std::forward<Args>(args)...) {}
+
+    /// Contained data - the referenced object for reference payloads
+    constexpr T& get() noexcept {
+        return question_mark::detail::stored_get(_storage.ok());
+    }
+
+    constexpr question_mark::detail::const_ref_t<T> get() const noexcept {
+        return question_mark::detail::stored_get(_storage.ok());
+    }
+
+    /// Contained error - the referenced object for reference payloads
+    constexpr E& get_err() noexcept {
+        return question_mark::detail::stored_get(_storage.err());
+    }
+
+    constexpr question_mark::detail::const_ref_t<E> get_err() const noexcept {
+        return question_mark::detail::stored_get(_storage.err());
+    }
+
+    question_mark::detail::result_storage_t<question_mark::detail::stored_t<T>, question_mark::detail::stored_t<E>> _storage;
+};
+
+namespace question_mark {
+namespace detail {
+
+/// Error taken out of a failed Result on the way to the caller - converts
+/// into any Result whose error can be created from it
+template <typename E>
+struct propagated_err {
+    E error;
+
+    template <typename T, typename F>
+    constexpr operator Result<T, F>() && {
+        return make_err<T, F>(std::move(error));
+    }
+};
+
+/// None on the way to the caller - converts into any Option
+struct propagated_none {
+    template <typename T>
+    constexpr operator Option<T>() const {
+        return make_none<T>();
+    }
+};
+
+template <typename T, typename E>
+constexpr bool failed(const Result<T, E>& result) {
+    return result.is_err();
+}
+
+template <typename T>
+constexpr bool failed(const Option<T>& option) {
+    return option.is_none();
+}
+
+template <typename T, typename E>
+constexpr propagated_err<E> propagate(Result<T, E>&& result) {
+    return {std::move(result).unwrap_err()};
+}
+
+template <typename T, typename E>
+constexpr propagated_err<E> propagate(const Result<T, E>& result) {
+    return {result.unwrap_err()};
+}
+
+template <typename T>
+constexpr propagated_none propagate(const Option<T>&) {
+    return {};
+}
+
+} // namespace detail
+} // namespace question_mark
+
+#define QUESTION_MARK_CONCAT_IMPL(A, B) A##B
+#define QUESTION_MARK_CONCAT(A, B) QUESTION_MARK_CONCAT_IMPL(A, B)
+
+/// Evaluates given Result or Option and declares DECL initialized with its value,
+/// or returns its error (or None) from the enclosing function, e.g.
+/// TRY(auto port, parse_port(text)); The error is moved, never copied.
+#ifndef TRY
+#define TRY(DECL, ...) TRY_IMPL(QUESTION_MARK_CONCAT(_question_mark_try_, __LINE__), DECL, __VA_ARGS__)
+#define TRY_IMPL(TMP, DECL, ...) \
+    auto TMP = (__VA_ARGS__); \
+    if (::question_mark::detail::failed(TMP)) { \
+        return ::question_mark::detail::propagate(std::move(TMP)); \
+    } \
+    DECL = std::move(TMP).unwrap()
+#endif
+
+#if QUESTION_MARK_HAS_COROUTINES
+namespace question_mark {
+namespace detail {
+
+/// Promise of a Result returning coroutine. The coroutine never suspends, so
+/// its result is complete by the time the call returns. Every call still
+/// allocates its frame unless the compiler elides it, which GCC does not:
+/// 16 nested co_await calls cost about 0.7-1 us and 16 allocations there,
+/// against under 30 ns and none for TRY (see propagate_ok/16).
+template <typename T, typename E>
+struct result_promise {
+    result_return_object<T, E> get_return_object() noexcept {
+        return result_return_object<T, E>(*this);
+    }
+
+    std::suspend_never initial_suspend() const noexcept {
+        return {};
+    }
+
+    std::suspend_never final_suspend() const noexcept {
+        return {};
+    }
+
+    void return_value(Result<T, E> result) {
+        set(std::move(result));
+    }
+
+    void return_value(T value) {
+        set(Result<T, E>::Ok(std::move(value)));
+    }
+
+    void unhandled_exception() {
+        throw;
+    }
+
+    void set(Result<T, E>&& result) {
+        _result->replace(std::move(result));
+    }
+
+    Option<Result<T, E>>* _result = nullptr;
+};
+
+/// Object returned from the promise. It owns the Result the body returns and
+/// is converted into it once the coroutine finished, which is the case for
+/// compilers deferring the conversion until the call returns (GCC, Clang).
+template <typename T, typename E>
+class result_return_object {
+public:
+    explicit result_return_object(result_promise<T, E>& promise) noexcept
+        : _promise(&promise), _value(make_none<Result<T, E>>()) {
+        promise._result = &_value;
+    }
+
+    /// Takes over the result - the promise is told about the new place only
+    /// while the body still runs, afterwards it no longer exists
+    result_return_object(result_return_object&& other) noexcept(std::is_nothrow_move_constructible<Result<T, E>>::value)
+        : _promise(other._promise), _value(std::move(other._value)) {
+        if (_value.is_none()) {
+            _promise->_result = &_value;
+        }
     }
 
-    std::unique_ptr<T> _ok;
-    std::unique_ptr<E> _err;
+    operator Result<T, E>() {
+        return std::move(_value).expect("Result coroutine converted before its body returned");
+    }
+
+private:
+    result_promise<T, E>* _promise;
+    Option<Result<T, E>> _value;
 };
 
+/// Awaiter of co_await on a Result
+template <typename T, typename E>
+struct result_awaiter {
+    Result<T, E> result;
+
+    bool await_ready() const noexcept {
+        return result.is_ok();
+    }
+
+    template <typename U, typename F>
+    void await_suspend(std::coroutine_handle<result_promise<U, F>> handle) {
+        handle.promise().set(make_err<U, F>(std::move(result).unwrap_err()));
+        handle.destroy();
+    }
+
+    T await_resume() {
+        return std::move(result).unwrap();
+    }
+};
 
+} // namespace detail
+} // namespace question_mark
+#endif
 
 #endif //QUESTION_MARK_HEADER
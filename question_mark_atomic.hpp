@@ -0,0 +1,337 @@
+#ifndef QUESTION_MARK_ATOMIC_HEADER
+#define QUESTION_MARK_ATOMIC_HEADER
+
+#include "question_mark.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+namespace question_mark {
+namespace detail {
+
+/// Hints the CPU that the thread is spinning
+inline void cpu_relax() noexcept {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+    __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+/// One byte test-and-test-and-set lock, yielding to the scheduler when the
+/// owner does not release it soon
+class spinlock {
+public:
+    void lock() noexcept {
+        for (unsigned spins = 0; _locked.exchange(true, std::memory_order_acquire); ) {
+            while (_locked.load(std::memory_order_relaxed)) {
+                if (++spins < 64) {
+                    cpu_relax();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    void unlock() noexcept {
+        _locked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> _locked{false};
+};
+
+/// Order of a failed compare-exchange made with given order
+constexpr std::memory_order failure_order(std::memory_order order) noexcept {
+    return order == std::memory_order_acq_rel ? std::memory_order_acquire
+        : order == std::memory_order_release ? std::memory_order_relaxed : order;
+}
+
+/// Options fitting a lock-free std::atomic are stored in one
+template <typename T>
+using lock_free_option = std::integral_constant<bool,
+    std::is_trivially_copyable<Option<T>>::value
+    && (sizeof(Option<T>) == 1 || sizeof(Option<T>) == 2 || sizeof(Option<T>) == 4 || sizeof(Option<T>) == 8)>;
+
+/// Whether the platform always makes atomics of given size lock-free
+constexpr bool lock_free_size(std::size_t size) noexcept {
+    return size == 1 ? ATOMIC_CHAR_LOCK_FREE == 2
+        : size == 2 ? ATOMIC_SHORT_LOCK_FREE == 2
+        : size == 4 ? ATOMIC_INT_LOCK_FREE == 2
+        : size == 8 ? ATOMIC_LLONG_LOCK_FREE == 2 : false;
+}
+
+/// Slot keeping the whole Option in a std::atomic
+template <typename T>
+class lock_free_slot {
+public:
+    static constexpr bool is_always_lock_free = lock_free_size(sizeof(Option<T>));
+
+    explicit lock_free_slot(Option<T> value) noexcept : _value(value) {}
+
+    Option<T> exchange(Option<T> value, std::memory_order order) noexcept {
+        return _value.exchange(value, order);
+    }
+
+    bool store_if_none(T& value, std::memory_order order) noexcept {
+        Option<T> expected = _value.load(failure_order(order));
+        Option<T> desired = Option<T>::Some(value);
+        while (expected.is_none()) {
+            if (_value.compare_exchange_weak(expected, desired, order, failure_order(order))) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Option<T> load(std::memory_order order) const noexcept {
+        return _value.load(order);
+    }
+
+    bool is_some(std::memory_order order) const noexcept {
+        return _value.load(order).is_some();
+    }
+
+private:
+    std::atomic<Option<T>> _value;
+};
+
+/// Slot keeping an object pointer in a std::atomic - none is a private address,
+/// so Some(nullptr) stays some
+template <typename U>
+class pointer_slot {
+public:
+    static constexpr bool is_always_lock_free = ATOMIC_POINTER_LOCK_FREE == 2;
+
+    explicit pointer_slot(Option<U*> value) noexcept : _ptr(value.unwrap_or(none_pointer<U>())) {}
+
+    Option<U*> exchange(Option<U*> value, std::memory_order order) noexcept {
+        return wrap(_ptr.exchange(value.unwrap_or(none_pointer<U>()), order));
+    }
+
+    bool store_if_none(U*& value, std::memory_order order) noexcept {
+        U* expected = none_pointer<U>();
+        return _ptr.compare_exchange_strong(expected, value, order, failure_order(order));
+    }
+
+    Option<U*> load(std::memory_order order) const noexcept {
+        return wrap(_ptr.load(order));
+    }
+
+    bool is_some(std::memory_order order) const noexcept {
+        return _ptr.load(order) != none_pointer<U>();
+    }
+
+private:
+    static Option<U*> wrap(U* ptr) noexcept {
+        return ptr == none_pointer<U>() ? make_none<U*>() : Option<U*>::Some(ptr);
+    }
+
+    std::atomic<U*> _ptr;
+};
+
+/// Slot keeping the raw pointer of a unique_ptr, see pointer_slot
+template <typename U>
+class unique_ptr_slot {
+public:
+    static constexpr bool is_always_lock_free = ATOMIC_POINTER_LOCK_FREE == 2;
+
+    explicit unique_ptr_slot(Option<std::unique_ptr<U>> value) noexcept : _ptr(release(std::move(value))) {}
+
+    unique_ptr_slot(const unique_ptr_slot&) = delete;
+    unique_ptr_slot& operator= (const unique_ptr_slot&) = delete;
+
+    ~unique_ptr_slot() {
+        U* ptr = _ptr.load(std::memory_order_acquire);
+        if (ptr != none_pointer<U>()) {
+            delete ptr;
+        }
+    }
+
+    Option<std::unique_ptr<U>> exchange(Option<std::unique_ptr<U>> value, std::memory_order order) noexcept {
+        U* ptr = _ptr.exchange(release(std::move(value)), order);
+        if (ptr == none_pointer<U>()) {
+            return make_none<std::unique_ptr<U>>();
+        }
+
+        return Option<std::unique_ptr<U>>::Some(std::unique_ptr<U>(ptr));
+    }
+
+    bool store_if_none(std::unique_ptr<U>& value, std::memory_order order) noexcept {
+        U* expected = none_pointer<U>();
+        if (_ptr.compare_exchange_strong(expected, value.get(), order, failure_order(order))) {
+            value.release();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool is_some(std::memory_order order) const noexcept {
+        return _ptr.load(order) != none_pointer<U>();
+    }
+
+private:
+    static U* release(Option<std::unique_ptr<U>> value) noexcept {
+        return value.is_some() ? std::move(value).unwrap().release() : none_pointer<U>();
+    }
+
+    std::atomic<U*> _ptr;
+};
+
+/// Slot guarding the Option with a spinlock - every operation is at least
+/// as strong as acquire-release
+template <typename T>
+class locked_slot {
+public:
+    static constexpr bool is_always_lock_free = false;
+
+    explicit locked_slot(Option<T> value) : _value(std::move(value)) {}
+
+    Option<T> exchange(Option<T> value, std::memory_order) {
+        _lock.lock();
+        std::swap(_value, value);
+        _lock.unlock();
+        return value;
+    }
+
+    bool store_if_none(T& value, std::memory_order) {
+        _lock.lock();
+        bool stored = _value.is_none();
+        if (stored) {
+            _value = Option<T>::Some(std::forward<T>(value));
+        }
+        _lock.unlock();
+        return stored;
+    }
+
+    Option<T> load(std::memory_order) const {
+        _lock.lock();
+        Option<T> value = _value;
+        _lock.unlock();
+        return value;
+    }
+
+    bool is_some(std::memory_order) const {
+        _lock.lock();
+        bool some = _value.is_some();
+        _lock.unlock();
+        return some;
+    }
+
+private:
+    mutable spinlock _lock;
+    Option<T> _value;
+};
+
+template <typename T>
+constexpr bool lock_free_slot<T>::is_always_lock_free;
+
+template <typename U>
+constexpr bool pointer_slot<U>::is_always_lock_free;
+
+template <typename U>
+constexpr bool unique_ptr_slot<U>::is_always_lock_free;
+
+template <typename T>
+constexpr bool locked_slot<T>::is_always_lock_free;
+
+template <typename T>
+struct atomic_slot {
+    using type = typename std::conditional<lock_free_option<T>::value, lock_free_slot<T>, locked_slot<T>>::type;
+};
+
+template <typename U>
+struct atomic_slot<U*> {
+    using type = typename std::conditional<std::is_object<U>::value, pointer_slot<U>, locked_slot<U*>>::type;
+};
+
+template <typename U>
+struct atomic_slot<std::unique_ptr<U>> {
+    using type = unique_ptr_slot<U>;
+};
+
+} // namespace detail
+
+/// Option shared between threads, e.g. to hand over the latest value or
+/// a one-shot result. It is lock-free when Option<T> is a trivially copyable
+/// object of up to 8 bytes - niche-optimized and small payloads - or T is an
+/// object pointer or a std::unique_ptr; other payloads are guarded by a spinlock.
+/// Operations take the memory order of the access; successful writes default
+/// to acquire-release and reads to acquire.
+template <typename T>
+class AtomicOption {
+    static_assert(!std::is_reference<T>::value, "AtomicOption keeps values, share pointers instead of references");
+
+public:
+    /// True when no operation takes a lock
+    static constexpr bool is_always_lock_free = question_mark::detail::atomic_slot<T>::type::is_always_lock_free;
+
+    /// Creates slot containing none
+    AtomicOption() : _slot(detail::make_none<T>()) {}
+
+    /// Creates slot containing given option
+    explicit AtomicOption(Option<T> value) : _slot(std::move(value)) {}
+
+    AtomicOption(const AtomicOption&) = delete;
+    AtomicOption& operator= (const AtomicOption&) = delete;
+
+    /// Takes the value out of the slot leaving none in its place
+    Option<T> take(std::memory_order order = std::memory_order_acq_rel) {
+        return _slot.exchange(detail::make_none<T>(), order);
+    }
+
+    /// Puts given value into the slot and returns the previous one
+    Option<T> replace(T value, std::memory_order order = std::memory_order_acq_rel) {
+        return _slot.exchange(Option<T>::Some(std::forward<T>(value)), order);
+    }
+
+    /// Puts given value into the slot when it contains none and returns
+    /// whether it did. The value is left untouched when the slot is taken,
+    /// the failed check uses the order without its release part.
+    bool compare_and_set_if_none(T&& value, std::memory_order order = std::memory_order_acq_rel) {
+        return _slot.store_if_none(value, order);
+    }
+
+    bool compare_and_set_if_none(const T& value, std::memory_order order = std::memory_order_acq_rel) {
+        T copy = value;
+        return _slot.store_if_none(copy, order);
+    }
+
+    /// Returns copy of the contained option - only for copyable payloads
+    Option<T> load(std::memory_order order = std::memory_order_acquire) const {
+        return _slot.load(order);
+    }
+
+    /// Checks if slot contains value
+    bool is_some(std::memory_order order = std::memory_order_acquire) const {
+        return _slot.is_some(order);
+    }
+
+    /// Checks if slot contains none
+    bool is_none(std::memory_order order = std::memory_order_acquire) const {
+        return !_slot.is_some(order);
+    }
+
+private:
+    typename question_mark::detail::atomic_slot<T>::type _slot;
+};
+
+template <typename T>
+constexpr bool AtomicOption<T>::is_always_lock_free;
+
+} // namespace question_mark
+
+#endif //QUESTION_MARK_ATOMIC_HEADER
@@ -0,0 +1,394 @@
+#ifndef QUESTION_MARK_BOX_HEADER
+#define QUESTION_MARK_BOX_HEADER
+
+#include "question_mark.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// Boxes allocate from std::pmr::memory_resource when the standard library
+/// provides it, from an interface with the same members otherwise
+#if defined(__has_include) && __cplusplus >= 201703L
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define QUESTION_MARK_HAS_PMR 1
+#endif
+#endif
+#ifndef QUESTION_MARK_HAS_PMR
+#define QUESTION_MARK_HAS_PMR 0
+#endif
+
+namespace question_mark {
+
+#if QUESTION_MARK_HAS_PMR
+using memory_resource = std::pmr::memory_resource;
+#else
+/// Source of memory of boxes - mirrors std::pmr::memory_resource
+class memory_resource {
+public:
+    virtual ~memory_resource() = default;
+
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+        return do_allocate(bytes, alignment);
+    }
+
+    void deallocate(void* ptr, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+        do_deallocate(ptr, bytes, alignment);
+    }
+
+    bool is_equal(const memory_resource& other) const noexcept {
+        return do_is_equal(other);
+    }
+
+private:
+    virtual void* do_allocate(std::size_t bytes, std::size_t alignment) = 0;
+    virtual void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) = 0;
+    virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+};
+#endif
+
+namespace detail {
+
+/// Resource forwarding to the global operator new and delete - the aligned
+/// ones only for over-aligned types, which need C++17
+class new_delete_resource final : public memory_resource {
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+#if defined(__cpp_aligned_new)
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return ::operator new(bytes, std::align_val_t(alignment));
+        }
+#else
+        assert(alignment <= alignof(std::max_align_t));
+#endif
+        (void) alignment;
+        return ::operator new(bytes);
+    }
+
+    void do_deallocate(void* ptr, std::size_t, std::size_t alignment) override {
+#if defined(__cpp_aligned_new)
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(ptr, std::align_val_t(alignment));
+            return;
+        }
+#endif
+        (void) alignment;
+        ::operator delete(ptr);
+    }
+
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace detail
+
+/// Resource using the global operator new and delete
+inline memory_resource* new_delete_resource() noexcept {
+    static detail::new_delete_resource resource;
+    return &resource;
+}
+
+/// Resource used by boxes created without one - the default resource of
+/// std::pmr when it exists
+inline memory_resource* default_resource() noexcept {
+#if QUESTION_MARK_HAS_PMR
+    return std::pmr::get_default_resource();
+#else
+    return new_delete_resource();
+#endif
+}
+
+/// Arena handing out memory from chunks of growing size and freeing it all at
+/// once - deallocation of single objects does nothing. Suited for payloads
+/// living as long as a request: allocate them in the arena and reset it when
+/// the request is done.
+class monotonic_arena : public memory_resource {
+public:
+    explicit monotonic_arena(std::size_t initial_size = 4096, memory_resource* upstream = new_delete_resource())
+        : _next_size(initial_size < sizeof(chunk) * 2 ? sizeof(chunk) * 2 : initial_size), _upstream(upstream) {}
+
+    monotonic_arena(const monotonic_arena&) = delete;
+    monotonic_arena& operator= (const monotonic_arena&) = delete;
+
+    ~monotonic_arena() override {
+        release();
+    }
+
+    /// Frees every chunk back to the upstream resource
+    void release() noexcept {
+        while (_chunks != nullptr) {
+            chunk* previous = _chunks->previous;
+            _upstream->deallocate(_chunks, _chunks->size, alignof(chunk));
+            _chunks = previous;
+        }
+        _current = nullptr;
+        _end = nullptr;
+    }
+
+    /// Frees every chunk but the last and largest one, which is reused by
+    /// the following allocations
+    void reset() noexcept {
+        if (_chunks == nullptr) {
+            return;
+        }
+
+        chunk* last = _chunks;
+        _chunks = last->previous;
+        release();
+        last->previous = nullptr;
+        _chunks = last;
+        _current = reinterpret_cast<char*>(last + 1);
+        _end = reinterpret_cast<char*>(last) + last->size;
+    }
+
+    /// Bytes requested from the upstream resource and not yet freed
+    std::size_t capacity() const noexcept {
+        std::size_t size = 0;
+        for (chunk* current = _chunks; current != nullptr; current = current->previous) {
+            size += current->size;
+        }
+
+        return size;
+    }
+
+private:
+    struct alignas(std::max_align_t) chunk {
+        chunk* previous;
+        std::size_t size;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        char* ptr = align(_current, alignment);
+        if (ptr == nullptr || ptr + bytes > _end) {
+            grow(bytes + alignment);
+            ptr = align(_current, alignment);
+        }
+
+        _current = ptr + bytes;
+        return ptr;
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    static char* align(char* ptr, std::size_t alignment) noexcept {
+        auto address = reinterpret_cast<std::uintptr_t>(ptr);
+        return ptr == nullptr ? nullptr : ptr + ((alignment - address % alignment) % alignment);
+    }
+
+    void grow(std::size_t bytes) {
+        std::size_t size = _next_size;
+        while (size < bytes + sizeof(chunk)) {
+            size *= 2;
+        }
+
+        auto* added = static_cast<chunk*>(_upstream->allocate(size, alignof(chunk)));
+        added->previous = _chunks;
+        added->size = size;
+        _chunks = added;
+        _current = reinterpret_cast<char*>(added + 1);
+        _end = reinterpret_cast<char*>(added) + size;
+        _next_size = size * 2;
+    }
+
+    chunk* _chunks = nullptr;
+    char* _current = nullptr;
+    char* _end = nullptr;
+    std::size_t _next_size;
+    memory_resource* _upstream;
+};
+
+template <typename T>
+class Box;
+
+/// Empty boxes - only left behind by moves - serve as none, so an Option of
+/// a Box is as large as the Box
+template <typename T>
+struct option_traits<Box<T>> {
+    static constexpr bool has_niche = true;
+
+    static Box<T> none() noexcept {
+        return Box<T>(nullptr);
+    }
+
+    static bool is_none(const Box<T>& value) noexcept {
+        return value.get() == nullptr;
+    }
+};
+
+/// Owning pointer to a value allocated from a memory resource. Copies
+/// allocate from the same resource; moved-from boxes are empty and must not
+/// be dereferenced. T may be incomplete where the Box is declared, so boxes
+/// can build recursive structures.
+template <typename T>
+class Box {
+public:
+    /// Creates value in a box allocated from the default resource
+    template <typename... Args>
+    static Box make(Args&&... args) {
+        return make_in(*default_resource(), std::forward<Args>(args)...);
+    }
+
+    /// Creates value in a box allocated from given resource
+    template <typename... Args>
+    static Box make_in(memory_resource& resource, Args&&... args) {
+        allocation memory(resource);
+        T* ptr = ::new (memory.ptr) T(std::forward<Args>(args)...);
+        memory.ptr = nullptr;
+        return Box(ptr, &resource);
+    }
+
+    Box(const Box& other) : Box(other.clone()) {}
+
+    Box(Box&& other) noexcept : _ptr(other._ptr), _resource(other._resource) {
+        other._ptr = nullptr;
+    }
+
+    Box& operator= (const Box& other) {
+        if (this != &other) {
+            *this = other.clone();
+        }
+
+        return *this;
+    }
+
+    Box& operator= (Box&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            _ptr = other._ptr;
+            _resource = other._resource;
+            other._ptr = nullptr;
+        }
+
+        return *this;
+    }
+
+    ~Box() {
+        destroy();
+    }
+
+    T& operator* () const noexcept {
+        return *_ptr;
+    }
+
+    T* operator-> () const noexcept {
+        return _ptr;
+    }
+
+    T* get() const noexcept {
+        return _ptr;
+    }
+
+    /// Resource the value was allocated from
+    memory_resource* resource() const noexcept {
+        return _resource;
+    }
+
+    /// Compares the boxed values
+    bool operator== (const Box& other) const {
+        if (_ptr == nullptr || other._ptr == nullptr) {
+            return _ptr == other._ptr;
+        }
+
+        return *_ptr == *other._ptr;
+    }
+
+private:
+    friend struct option_traits<Box<T>>;
+
+    /// Memory for the value, returned to the resource unless the value
+    /// was constructed in it
+    struct allocation {
+        explicit allocation(memory_resource& resource)
+            : resource(resource), ptr(resource.allocate(sizeof(T), alignof(T))) {}
+
+        ~allocation() {
+            if (ptr != nullptr) {
+                resource.deallocate(ptr, sizeof(T), alignof(T));
+            }
+        }
+
+        memory_resource& resource;
+        void* ptr;
+    };
+
+    explicit Box(std::nullptr_t) noexcept : _ptr(nullptr), _resource(nullptr) {}
+
+    Box(T* ptr, memory_resource* resource) noexcept : _ptr(ptr), _resource(resource) {}
+
+    Box clone() const {
+        if (_ptr == nullptr) {
+            return Box(nullptr);
+        }
+
+        return make_in(*_resource, *_ptr);
+    }
+
+    void destroy() noexcept {
+        if (_ptr != nullptr) {
+            _ptr->~T();
+            _resource->deallocate(_ptr, sizeof(T), alignof(T));
+            _ptr = nullptr;
+        }
+    }
+
+    T* _ptr;
+    memory_resource* _resource;
+};
+
+/// Option keeping its value in a Box
+template <typename T>
+using BoxedOption = Option<Box<T>>;
+
+/// Result keeping its data in a Box
+template <typename T, typename E>
+using BoxedResult = Result<Box<T>, E>;
+
+/// Default size in bytes above which payload_t boxes a payload
+constexpr std::size_t box_threshold = 256;
+
+/// Payload kept inline when it fits into Threshold bytes and boxed otherwise
+template <typename T, std::size_t Threshold = box_threshold>
+using payload_t = typename std::conditional<(sizeof(T) > Threshold), Box<T>, T>::type;
+
+/// Option holding T inline or boxed depending on its size
+template <typename T, std::size_t Threshold = box_threshold>
+using CompactOption = Option<payload_t<T, Threshold>>;
+
+/// Result holding T inline or boxed depending on its size
+template <typename T, typename E, std::size_t Threshold = box_threshold>
+using CompactResult = Result<payload_t<T, Threshold>, E>;
+
+namespace detail {
+
+template <typename T, typename... Args>
+T make_payload(std::false_type, memory_resource&, Args&&... args) {
+    return T(std::forward<Args>(args)...);
+}
+
+template <typename T, typename... Args>
+Box<T> make_payload(std::true_type, memory_resource& resource, Args&&... args) {
+    return Box<T>::make_in(resource, std::forward<Args>(args)...);
+}
+
+} // namespace detail
+
+/// Creates payload_t<T, Threshold> - boxed in given resource when T is
+/// larger than the threshold, the resource is unused otherwise
+template <typename T, std::size_t Threshold = box_threshold, typename... Args>
+payload_t<T, Threshold> make_payload(memory_resource& resource, Args&&... args) {
+    return detail::make_payload<T>(std::integral_constant<bool, (sizeof(T) > Threshold)>(),
+                                   resource, std::forward<Args>(args)...);
+}
+
+} // namespace question_mark
+
+#endif //QUESTION_MARK_BOX_HEADER
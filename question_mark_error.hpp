@@ -0,0 +1,313 @@
+#ifndef QUESTION_MARK_ERROR_HEADER
+#define QUESTION_MARK_ERROR_HEADER
+
+#include "question_mark.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/// Number of error domains a program can register, at most 4096
+#ifndef QUESTION_MARK_MAX_ERROR_DOMAINS
+#define QUESTION_MARK_MAX_ERROR_DOMAINS 256
+#endif
+
+/// Number of context entries kept per thread, a power of two - older ones
+/// are overwritten
+#ifndef QUESTION_MARK_ERROR_CONTEXT_CAPACITY
+#define QUESTION_MARK_ERROR_CONTEXT_CAPACITY 64
+#endif
+
+namespace question_mark {
+
+/// Family of error codes sharing a name and a static table of messages
+/// indexed by code. Domains get a small id on first use, so an Error can refer
+/// to its domain with 12 bits. They have to live as long as errors using them
+/// do, e.g. as function-local statics:
+///
+///     const error_domain& parse_errors() {
+///         static const char* const messages[] = {"no error", "invalid digit"};
+///         static const error_domain domain("parse", messages);
+///         return domain;
+///     }
+class error_domain {
+public:
+    template <std::size_t N>
+    constexpr error_domain(const char* name, const char* const (&messages)[N]) noexcept
+        : _name(name), _messages(messages), _count(N), _id(0) {}
+
+    constexpr explicit error_domain(const char* name) noexcept
+        : _name(name), _messages(nullptr), _count(0), _id(0) {}
+
+    error_domain(const error_domain&) = delete;
+    error_domain& operator= (const error_domain&) = delete;
+
+    const char* name() const noexcept {
+        return _name;
+    }
+
+    /// Message of given code - interned in the domain's table
+    const char* message(std::int32_t code) const noexcept {
+        if (code < 0 || static_cast<std::size_t>(code) >= _count || _messages[code] == nullptr) {
+            return "unknown error";
+        }
+
+        return _messages[code];
+    }
+
+    /// Registers the domain on first call and returns its id
+    std::uint16_t id() const;
+
+private:
+    const char* _name;
+    const char* const* _messages;
+    std::size_t _count;
+    mutable std::atomic<std::uint16_t> _id;
+};
+
+namespace detail {
+
+/// Largest domain id an Error can hold
+constexpr std::uint32_t domain_mask = 0xfff;
+static_assert(QUESTION_MARK_MAX_ERROR_DOMAINS <= domain_mask + 1, "QUESTION_MARK_MAX_ERROR_DOMAINS must be at most 4096");
+
+/// Registered domains indexed by their ids. Id 0 is the generic domain of
+/// default constructed errors.
+struct domain_registry {
+    std::atomic<const error_domain*> domains[QUESTION_MARK_MAX_ERROR_DOMAINS];
+    std::atomic<std::uint32_t> count;
+};
+
+inline const error_domain& generic_domain() noexcept {
+    static const error_domain domain("error");
+    return domain;
+}
+
+inline domain_registry& registry() noexcept {
+    static domain_registry instance{{}, {1}};
+    return instance;
+}
+
+inline const error_domain& domain_of(std::uint16_t id) noexcept {
+    const error_domain* domain = id == 0 ? nullptr : registry().domains[id].load(std::memory_order_acquire);
+    return domain != nullptr ? *domain : generic_domain();
+}
+
+/// Errors refer to their context by the low bits of a counter shared by all
+/// threads, so a tag names a single context of a single thread until 2^20
+/// more contexts were added in the whole program. Tag 0 means none.
+constexpr unsigned context_tag_bits = 20;
+constexpr std::uint64_t context_tag_mask = (std::uint64_t(1) << context_tag_bits) - 1;
+
+inline std::atomic<std::uint64_t>& context_counter() noexcept {
+    static std::atomic<std::uint64_t> counter{0};
+    return counter;
+}
+
+/// Context attached to an error: static message, full counter value it was
+/// added with and tag of the context it wraps
+struct context_entry {
+    const char* message;
+    std::uint64_t tag;
+    std::uint32_t previous;
+};
+
+/// Bounded ring of contexts of the calling thread. Entries are found by tag,
+/// so errors whose context was overwritten, or added on another thread, lose
+/// it instead of showing a wrong one.
+struct context_ring {
+    static constexpr std::size_t capacity = QUESTION_MARK_ERROR_CONTEXT_CAPACITY;
+    static_assert(capacity != 0 && (capacity & (capacity - 1)) == 0 && capacity <= context_tag_mask,
+        "QUESTION_MARK_ERROR_CONTEXT_CAPACITY must be a power of two");
+
+    context_entry entries[capacity];
+
+    std::uint32_t push(const char* message, std::uint32_t previous) noexcept {
+        std::uint64_t tag;
+        do {
+            tag = context_counter().fetch_add(1, std::memory_order_relaxed) + 1;
+        } while ((tag & context_tag_mask) == 0);
+
+        entries[tag % capacity] = context_entry{message, tag, previous};
+        return static_cast<std::uint32_t>(tag & context_tag_mask);
+    }
+
+    const context_entry* find(std::uint32_t tag) const noexcept {
+        const context_entry& entry = entries[tag % capacity];
+        return tag != 0 && (entry.tag & context_tag_mask) == tag ? &entry : nullptr;
+    }
+};
+
+inline context_ring& local_contexts() noexcept {
+    static thread_local context_ring ring{};
+    return ring;
+}
+
+} // namespace detail
+
+inline std::uint16_t error_domain::id() const {
+    std::uint16_t id = _id.load(std::memory_order_acquire);
+    if (QUESTION_MARK_UNLIKELY(id == 0)) {
+        auto& registry = detail::registry();
+        std::uint32_t index = registry.count.fetch_add(1, std::memory_order_relaxed);
+        if (index >= QUESTION_MARK_MAX_ERROR_DOMAINS || index > detail::domain_mask) {
+            PANIC("Too many error domains, raise QUESTION_MARK_MAX_ERROR_DOMAINS");
+        }
+
+        registry.domains[index].store(this, std::memory_order_release);
+        id = static_cast<std::uint16_t>(index);
+        std::uint16_t expected = 0;
+        if (!_id.compare_exchange_strong(expected, id, std::memory_order_acq_rel)) {
+            id = expected;
+        }
+    }
+
+    return id;
+}
+
+/// Customization point mapping an enum of error codes to its domain.
+/// Specializations provide domain() returning the error_domain, which makes
+/// the enum implicitly convertible to Error.
+template <typename T>
+struct error_traits;
+
+/// Error code of a domain - a single trivially copyable word, so
+/// Result<int, Error> is returned in two registers and failing allocates
+/// nothing. Messages are formatted only when printed.
+class Error {
+public:
+    /// Creates unspecified error of the generic domain
+    constexpr Error() noexcept : _bits(0) {}
+
+    Error(const error_domain& domain, std::int32_t code) noexcept
+        : _bits(pack(code, domain.id())) {}
+
+    template <typename Code, typename = decltype(error_traits<Code>::domain())>
+    Error(Code code) noexcept
+        : Error(error_traits<Code>::domain(), static_cast<std::int32_t>(code)) {}
+
+    const error_domain& domain() const noexcept {
+        return detail::domain_of(static_cast<std::uint16_t>((_bits >> 32) & detail::domain_mask));
+    }
+
+    constexpr std::int32_t code() const noexcept {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(_bits));
+    }
+
+    /// Interned message of the code
+    const char* message() const noexcept {
+        return domain().message(code());
+    }
+
+    /// Returns the error wrapped in given context. The message is kept by
+    /// pointer in a bounded buffer of the calling thread, so it has to be
+    /// a string literal or otherwise outlive the error, and the contexts are
+    /// visible only on that thread - elsewhere the error prints without them.
+    Error context(const char* message) const noexcept {
+        std::uint32_t tag = detail::local_contexts().push(message, context_tag());
+        Error wrapped;
+        wrapped._bits = (_bits & context_mask) | (std::uint64_t(tag) << context_shift);
+        return wrapped;
+    }
+
+    /// Calls given function with messages of the contexts, outermost first
+    template <typename F>
+    void for_each_context(F&& fn) const {
+        const auto& ring = detail::local_contexts();
+        std::uint32_t tag = context_tag();
+        for (std::size_t depth = 0; depth < detail::context_ring::capacity; ++depth) {
+            const detail::context_entry* entry = ring.find(tag);
+            if (entry == nullptr) {
+                return;
+            }
+
+            fn(entry->message);
+            tag = entry->previous;
+        }
+    }
+
+    /// Writes "context: ...: domain: message" into given buffer, truncated
+    /// and always terminated, returns length of the whole text
+    std::size_t format(char* buffer, std::size_t size) const {
+        std::size_t length = 0;
+        auto append = [&](const char* text) {
+            std::size_t text_length = std::strlen(text);
+            if (length < size) {
+                std::size_t copied = text_length < size - length ? text_length : size - length;
+                std::memcpy(buffer + length, text, copied);
+            }
+            length += text_length;
+        };
+
+        for_each_context([&](const char* context) {
+            append(context);
+            append(": ");
+        });
+        append(domain().name());
+        append(": ");
+        append(message());
+
+        if (size > 0) {
+            buffer[length < size ? length : size - 1] = '\0';
+        }
+
+        return length;
+    }
+
+    std::string to_string() const {
+        char buffer[256];
+        std::size_t length = format(buffer, sizeof(buffer));
+        if (length < sizeof(buffer)) {
+            return std::string(buffer, length);
+        }
+
+        std::string text(length, '\0');
+        format(&text[0], length + 1);
+        return text;
+    }
+
+    /// Errors are equal when they have the same domain and code, contexts
+    /// are not compared
+    constexpr bool operator== (const Error& other) const noexcept {
+        return (_bits & context_mask) == (other._bits & context_mask);
+    }
+
+    constexpr bool operator!= (const Error& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    /// Bits of the code and the domain id - the rest is the context tag
+    static constexpr unsigned context_shift = 64 - detail::context_tag_bits;
+    static constexpr std::uint64_t context_mask = (std::uint64_t(1) << context_shift) - 1;
+
+    static constexpr std::uint64_t pack(std::int32_t code, std::uint16_t domain) noexcept {
+        return std::uint64_t(static_cast<std::uint32_t>(code)) | (std::uint64_t(domain) << 32);
+    }
+
+    std::uint32_t context_tag() const noexcept {
+        return static_cast<std::uint32_t>(_bits >> context_shift);
+    }
+
+    /// Code in the low 32 bits, 12 bits of domain id and the context tag
+    /// above - one integer, so compilers keep Results of errors in registers
+    std::uint64_t _bits;
+};
+
+/// Adds context to the error of given result, e.g.
+/// TRY(auto header, with_context(parse_header(text), "reading header"));
+template <typename T>
+Result<T, Error> with_context(Result<T, Error> result, const char* message) {
+    if (result.is_err()) {
+        return detail::make_err<T, Error>(result.unwrap_err().context(message));
+    }
+
+    return result;
+}
+
+} // namespace question_mark
+
+#endif //QUESTION_MARK_ERROR_HEADER
@@ -0,0 +1,318 @@
+#ifndef QUESTION_MARK_ITER_HEADER
+#define QUESTION_MARK_ITER_HEADER
+
+#include "question_mark.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace question_mark {
+namespace detail {
+
+template <typename Range>
+using range_iterator_t = decltype(std::begin(std::declval<Range&>()));
+
+template <typename Range>
+using range_reference_t = decltype(*std::begin(std::declval<Range&>()));
+
+/// Elements are moved out of ranges passed as rvalues and out of ranges
+/// producing temporaries, copied otherwise
+template <typename Range>
+using consumes_elements = std::integral_constant<bool,
+    !std::is_lvalue_reference<Range>::value || !std::is_reference<range_reference_t<Range>>::value>;
+
+template <bool Consume, typename T>
+constexpr typename std::conditional<Consume, T&&, T&>::type forward_element(T& element) noexcept {
+    return static_cast<typename std::conditional<Consume, T&&, T&>::type>(element);
+}
+
+/// Reference to an element of Range as passed to the consuming algorithms
+template <typename Range>
+using forwarded_element_t = decltype(forward_element<consumes_elements<Range>::value>(
+    std::declval<typename std::remove_reference<range_reference_t<Range>>::type&>()));
+
+/// Describes Option and Result as outcomes of fallible steps - the type of
+/// their value and the same kind of outcome carrying another value
+template <typename T>
+struct try_traits;
+
+template <typename T>
+struct try_traits<Option<T>> {
+    using value_type = T;
+
+    template <typename U>
+    using rebind = Option<U>;
+
+    template <typename U>
+    static constexpr Option<U> success(U value) {
+        return Option<U>::Some(std::move(value));
+    }
+};
+
+template <typename T, typename E>
+struct try_traits<Result<T, E>> {
+    using value_type = T;
+
+    template <typename U>
+    using rebind = Result<U, E>;
+
+    template <typename U>
+    static constexpr Result<U, E> success(U value) {
+        return Result<U, E>::Ok(std::move(value));
+    }
+};
+
+template <typename T, typename Iterator>
+void reserve_for(std::vector<T>& values, Iterator first, Iterator last, std::random_access_iterator_tag) {
+    values.reserve(static_cast<std::size_t>(last - first));
+}
+
+template <typename T, typename Iterator>
+void reserve_for(std::vector<T>&, Iterator, Iterator, std::input_iterator_tag) {}
+
+/// Weakest of the iterator categories of an adapter and of the adapted iterator
+template <typename Iterator, typename Category>
+using adapted_category_t = typename std::conditional<
+    std::is_base_of<Category, typename std::iterator_traits<Iterator>::iterator_category>::value,
+    Category, std::input_iterator_tag>::type;
+
+/// Iterator over the values of Options (or the data of Results) skipping
+/// the empty ones
+template <typename Iterator>
+class flatten_iterator {
+public:
+    using iterator_category = adapted_category_t<Iterator, std::forward_iterator_tag>;
+    using reference = decltype(*(*std::declval<Iterator&>()).iter().begin());
+    using value_type = typename std::decay<reference>::type;
+    using pointer = typename std::remove_reference<reference>::type*;
+    using difference_type = std::ptrdiff_t;
+
+    flatten_iterator() = default;
+
+    flatten_iterator(Iterator current, Iterator end) : _current(current), _end(end) {
+        skip_empty();
+    }
+
+    reference operator* () const {
+        return *(*_current).iter().begin();
+    }
+
+    pointer operator-> () const {
+        return (*_current).iter().begin();
+    }
+
+    flatten_iterator& operator++ () {
+        ++_current;
+        skip_empty();
+        return *this;
+    }
+
+    flatten_iterator operator++ (int) {
+        flatten_iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator== (const flatten_iterator& other) const {
+        return _current == other._current;
+    }
+
+    bool operator!= (const flatten_iterator& other) const {
+        return _current != other._current;
+    }
+
+private:
+    void skip_empty() {
+        while (_current != _end && (*_current).iter().empty()) {
+            ++_current;
+        }
+    }
+
+    Iterator _current;
+    Iterator _end;
+};
+
+/// Iterator over the values of Options returned by a function applied to
+/// elements of the adapted range. The current value is kept in the iterator,
+/// so it can be moved out but not referenced after advancing.
+template <typename Iterator, typename F>
+class filter_map_iterator {
+public:
+    using option_type = call_result_t<F&, decltype(*std::declval<Iterator&>())>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = typename try_traits<option_type>::value_type;
+    using reference = value_type&;
+    using pointer = value_type*;
+    using difference_type = std::ptrdiff_t;
+
+    static_assert(std::is_same<option_type, Option<value_type>>::value,
+        "filter_map requires a function returning Option");
+
+    filter_map_iterator(Iterator current, Iterator end, F* fn)
+        : _current(current), _end(end), _fn(fn), _value(factory::none<option_type>()) {
+        find_value();
+    }
+
+    reference operator* () {
+        return *_value.iter().begin();
+    }
+
+    pointer operator-> () {
+        return _value.iter().begin();
+    }
+
+    filter_map_iterator& operator++ () {
+        ++_current;
+        find_value();
+        return *this;
+    }
+
+    void operator++ (int) {
+        ++*this;
+    }
+
+    bool operator== (const filter_map_iterator& other) const {
+        return _current == other._current;
+    }
+
+    bool operator!= (const filter_map_iterator& other) const {
+        return _current != other._current;
+    }
+
+private:
+    /// Works on local copies, so the loop keeps them in registers even when
+    /// the caller stores values through pointers which could alias the iterator
+    void find_value() {
+        Iterator current = _current;
+        F& fn = *_fn;
+        for (; current != _end; ++current) {
+            option_type value = fn(*current);
+            if (value.is_some()) {
+                _value = std::move(value);
+                break;
+            }
+        }
+        _current = current;
+    }
+
+    Iterator _current;
+    Iterator _end;
+    F* _fn;
+    option_type _value;
+};
+
+/// Lazy view over the values of a range of Options or Results. It refers to
+/// ranges passed as lvalues and takes ownership of the ones passed as rvalues.
+template <typename Range>
+class flatten_view {
+public:
+    explicit flatten_view(Range&& range) : _range(std::forward<Range>(range)) {}
+
+    flatten_iterator<range_iterator_t<Range>> begin() {
+        return {std::begin(_range), std::end(_range)};
+    }
+
+    flatten_iterator<range_iterator_t<Range>> end() {
+        return {std::end(_range), std::end(_range)};
+    }
+
+    flatten_iterator<range_iterator_t<const Range>> begin() const {
+        return {std::begin(_range), std::end(_range)};
+    }
+
+    flatten_iterator<range_iterator_t<const Range>> end() const {
+        return {std::end(_range), std::end(_range)};
+    }
+
+private:
+    Range _range;
+};
+
+/// Lazy view applying a function returning Option to every element of a range
+/// and keeping the values. The function is called once per element and pass.
+template <typename Range, typename F>
+class filter_map_view {
+public:
+    filter_map_view(Range&& range, F fn) : _range(std::forward<Range>(range)), _fn(std::move(fn)) {}
+
+    filter_map_iterator<range_iterator_t<Range>, F> begin() {
+        return {std::begin(_range), std::end(_range), &_fn};
+    }
+
+    filter_map_iterator<range_iterator_t<Range>, F> end() {
+        return {std::end(_range), std::end(_range), &_fn};
+    }
+
+private:
+    Range _range;
+    F _fn;
+};
+
+} // namespace detail
+
+/// Returns lazy view over the values of given Options or data of given
+/// Results, skipping None and errors
+template <typename Range>
+detail::flatten_view<Range> flatten(Range&& range) {
+    return detail::flatten_view<Range>(std::forward<Range>(range));
+}
+
+/// Returns lazy view over the values of Options returned by given function
+/// for the elements of given range, skipping None
+template <typename Range, typename F>
+detail::filter_map_view<Range, typename std::decay<F>::type> filter_map(Range&& range, F&& fn) {
+    return {std::forward<Range>(range), std::forward<F>(fn)};
+}
+
+/// Collects values of given Options or data of given Results into a vector,
+/// or returns the first None or error without looking at the rest. The vector
+/// is reserved up front for random access ranges and values are moved out of
+/// ranges passed as rvalues.
+template <typename Range,
+    typename Traits = detail::try_traits<typename std::decay<detail::range_reference_t<Range>>::type>>
+typename Traits::template rebind<std::vector<typename Traits::value_type>> collect(Range&& range) {
+    constexpr bool consume = detail::consumes_elements<Range>::value;
+    std::vector<typename Traits::value_type> values;
+    auto first = std::begin(range);
+    auto last = std::end(range);
+    detail::reserve_for(values, first, last, typename std::iterator_traits<decltype(first)>::iterator_category());
+
+    for (; first != last; ++first) {
+        auto&& element = *first;
+        if (detail::failed(element)) {
+            return detail::propagate(detail::forward_element<consume>(element));
+        }
+
+        values.push_back(detail::forward_element<consume>(*element.iter().begin()));
+    }
+
+    return Traits::success(std::move(values));
+}
+
+/// Folds given range with function returning Option or Result of the
+/// accumulator, stopping at the first None or error which is returned
+template <typename Range, typename Acc, typename F,
+    typename R = detail::call_result_t<F&, Acc, detail::forwarded_element_t<Range>>>
+R try_fold(Range&& range, Acc init, F&& fn) {
+    static_assert(std::is_same<typename detail::try_traits<R>::value_type, Acc>::value,
+        "try_fold requires a function returning Option or Result of the accumulator");
+    constexpr bool consume = detail::consumes_elements<Range>::value;
+
+    for (auto&& element : range) {
+        R next = fn(std::move(init), detail::forward_element<consume>(element));
+        if (detail::failed(next)) {
+            return next;
+        }
+
+        init = std::move(*next.iter().begin());
+    }
+
+    return detail::try_traits<R>::success(std::move(init));
+}
+
+} // namespace question_mark
+
+#endif //QUESTION_MARK_ITER_HEADER
@@ -0,0 +1,356 @@
+#ifndef QUESTION_MARK_PARALLEL_HEADER
+#define QUESTION_MARK_PARALLEL_HEADER
+
+#include "question_mark.hpp"
+#include "question_mark_iter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace question_mark {
+
+class thread_pool;
+
+namespace detail {
+
+/// Pool whose job the calling thread is running, if any
+inline const thread_pool*& current_pool() noexcept {
+    static thread_local const thread_pool* pool = nullptr;
+    return pool;
+}
+
+} // namespace detail
+
+/// Fixed set of threads running one job at a time. The calling thread takes
+/// part in the job as participant 0, so a pool of concurrency N starts N - 1
+/// threads.
+class thread_pool {
+public:
+    explicit thread_pool(unsigned concurrency = std::max(1u, std::thread::hardware_concurrency())) {
+        concurrency = std::max(1u, concurrency);
+        _workers.reserve(concurrency - 1);
+        for (unsigned index = 1; index < concurrency; ++index) {
+            _workers.emplace_back([this, index] {
+                work(index);
+            });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator= (const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    /// Number of participants of a job
+    unsigned concurrency() const noexcept {
+        return static_cast<unsigned>(_workers.size()) + 1;
+    }
+
+    /// Pool used by parallel_map unless given another one
+    static thread_pool& shared() {
+        static thread_pool pool;
+        return pool;
+    }
+
+    /// Calls job(participant) on every participant and returns when all of
+    /// them returned. When the pool is busy or called from its own job, the
+    /// calling thread runs job(0) alone, so jobs have to share their work
+    /// instead of relying on every participant to show up. The job must not
+    /// throw.
+    template <typename F>
+    void run(F& job) {
+        std::unique_lock<std::mutex> exclusive(_run_mutex, std::try_to_lock);
+        if (!exclusive.owns_lock() || detail::current_pool() == this || _workers.empty()) {
+            job(0u);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _job = &job;
+            _invoke = [](void* job, unsigned participant) {
+                (*static_cast<F*>(job))(participant);
+            };
+            _running = static_cast<unsigned>(_workers.size());
+            ++_generation;
+        }
+        _wake.notify_all();
+
+        const thread_pool* previous = detail::current_pool();
+        detail::current_pool() = this;
+        job(0u);
+        detail::current_pool() = previous;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this] {
+            return _running == 0;
+        });
+        _job = nullptr;
+    }
+
+private:
+    void work(unsigned index) {
+        detail::current_pool() = this;
+        std::uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _wake.wait(lock, [&] {
+                return _stopping || _generation != seen;
+            });
+            if (_stopping) {
+                return;
+            }
+
+            seen = _generation;
+            void* job = _job;
+            void (*invoke)(void*, unsigned) = _invoke;
+            lock.unlock();
+            invoke(job, index);
+            lock.lock();
+            if (--_running == 0) {
+                _done.notify_one();
+            }
+        }
+    }
+
+    std::mutex _run_mutex;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::vector<std::thread> _workers;
+    void* _job = nullptr;
+    void (*_invoke)(void*, unsigned) = nullptr;
+    std::uint64_t _generation = 0;
+    unsigned _running = 0;
+    bool _stopping = false;
+};
+
+namespace detail {
+
+/// Blocks [first, last) left to a participant, packed into one word so the
+/// owner taking them from the front and thieves taking them from the back
+/// claim them with a single compare-exchange. Padded to a cache line, so
+/// participants do not slow down each other's claims.
+class block_queue {
+public:
+    void assign(std::uint32_t first, std::uint32_t last) noexcept {
+        _bounds.store(pack(first, last), std::memory_order_relaxed);
+    }
+
+    bool pop_front(std::uint32_t& block) noexcept {
+        std::uint64_t bounds = _bounds.load(std::memory_order_relaxed);
+        while (first(bounds) < last(bounds)) {
+            if (_bounds.compare_exchange_weak(bounds, pack(first(bounds) + 1, last(bounds)),
+                                              std::memory_order_relaxed)) {
+                block = first(bounds);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool steal_back(std::uint32_t& block) noexcept {
+        std::uint64_t bounds = _bounds.load(std::memory_order_relaxed);
+        while (first(bounds) < last(bounds)) {
+            if (_bounds.compare_exchange_weak(bounds, pack(first(bounds), last(bounds) - 1),
+                                              std::memory_order_relaxed)) {
+                block = last(bounds) - 1;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    static std::uint64_t pack(std::uint32_t first, std::uint32_t last) noexcept {
+        return std::uint64_t(first) | (std::uint64_t(last) << 32);
+    }
+
+    static std::uint32_t first(std::uint64_t bounds) noexcept {
+        return static_cast<std::uint32_t>(bounds);
+    }
+
+    static std::uint32_t last(std::uint64_t bounds) noexcept {
+        return static_cast<std::uint32_t>(bounds >> 32);
+    }
+
+    std::atomic<std::uint64_t> _bounds{0};
+    char _padding[64 - sizeof(std::atomic<std::uint64_t>)];
+};
+
+/// Output written in place by index. Default constructible values go straight
+/// into the vector; others are kept in Options and moved over at the end.
+template <typename U, bool = std::is_default_constructible<U>::value && !std::is_same<U, bool>::value>
+class parallel_output {
+public:
+    explicit parallel_output(std::size_t size) : _values(size) {}
+
+    void set(std::size_t index, U&& value) {
+        _values[index] = std::move(value);
+    }
+
+    std::vector<U> finish() {
+        return std::move(_values);
+    }
+
+private:
+    std::vector<U> _values;
+};
+
+template <typename U>
+class parallel_output<U, false> {
+public:
+    explicit parallel_output(std::size_t size) {
+        _slots.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            _slots.push_back(make_none<U>());
+        }
+    }
+
+    void set(std::size_t index, U&& value) {
+        _slots[index] = Option<U>::Some(std::move(value));
+    }
+
+    std::vector<U> finish() {
+        std::vector<U> values;
+        values.reserve(_slots.size());
+        for (auto& slot : _slots) {
+            values.push_back(std::move(slot).unwrap());
+        }
+
+        return values;
+    }
+
+private:
+    std::vector<Option<U>> _slots;
+};
+
+} // namespace detail
+
+/// Applies function returning Result to every element of a random access
+/// range on the participants of given pool and collects the data in input
+/// order, or returns the error of the lowest index - the same outcome as
+/// collecting sequentially. Once an error is found, elements after it are
+/// skipped by all participants. Elements are split into blocks of grain
+/// elements (chosen automatically when 0), dealt out evenly and stolen by
+/// participants running out of their own. An exception thrown by the
+/// function stops the work and is rethrown.
+template <typename Range, typename F,
+    typename R = detail::call_result_t<F&, detail::range_reference_t<Range>>,
+    typename Traits = detail::try_traits<R>>
+typename Traits::template rebind<std::vector<typename Traits::value_type>>
+parallel_map(thread_pool& pool, Range&& range, F&& fn, std::size_t grain = 0) {
+    using U = typename Traits::value_type;
+    using iterator = detail::range_iterator_t<Range>;
+    static_assert(std::is_same<R, typename Traits::template rebind<U>>::value && !std::is_same<R, Option<U>>::value,
+        "parallel_map requires a function returning Result");
+    static_assert(std::is_base_of<std::random_access_iterator_tag,
+                                  typename std::iterator_traits<iterator>::iterator_category>::value,
+        "parallel_map requires a random access range");
+
+    iterator first = std::begin(range);
+    const std::size_t size = static_cast<std::size_t>(std::end(range) - first);
+    const unsigned participants = pool.concurrency();
+    if (grain == 0) {
+        grain = std::max<std::size_t>(1, size / (std::size_t(participants) * 8));
+    }
+    grain = std::max<std::size_t>(grain, size / 0x7fffffff + 1);
+    const auto blocks = static_cast<std::uint32_t>((size + grain - 1) / grain);
+
+    std::vector<detail::block_queue> queues(participants);
+    for (unsigned p = 0; p < participants; ++p) {
+        queues[p].assign(static_cast<std::uint32_t>(std::uint64_t(blocks) * p / participants),
+                         static_cast<std::uint32_t>(std::uint64_t(blocks) * (p + 1) / participants));
+    }
+
+    detail::parallel_output<U> output(size);
+    std::atomic<std::size_t> stop_at{size};
+    std::mutex failure_mutex;
+    std::size_t error_index = size;
+    Option<R> error = detail::make_none<R>();
+    std::exception_ptr exception;
+
+    auto process = [&](std::uint32_t block) {
+        std::size_t begin = std::size_t(block) * grain;
+        std::size_t end = std::min(size, begin + grain);
+        for (std::size_t i = begin; i < end && i < stop_at.load(std::memory_order_relaxed); ++i) {
+            R result = fn(first[static_cast<typename std::iterator_traits<iterator>::difference_type>(i)]);
+            if (QUESTION_MARK_UNLIKELY(detail::failed(result))) {
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if (i < error_index) {
+                    error_index = i;
+                    error = Option<R>::Some(std::move(result));
+                    stop_at.store(i, std::memory_order_relaxed);
+                }
+                return;
+            }
+
+            output.set(i, std::move(result).unwrap());
+        }
+    };
+
+    auto job = [&](unsigned participant) {
+        try {
+            std::uint32_t block;
+            while (queues[participant].pop_front(block)) {
+                process(block);
+            }
+            for (unsigned offset = 1; offset < participants; ) {
+                if (queues[(participant + offset) % participants].steal_back(block)) {
+                    process(block);
+                } else {
+                    ++offset;
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(failure_mutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+            stop_at.store(0, std::memory_order_relaxed);
+        }
+    };
+    pool.run(job);
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+    if (error_index < size) {
+        return detail::propagate(std::move(error).unwrap());
+    }
+
+    return Traits::success(output.finish());
+}
+
+/// Applies function returning Result to every element of a random access
+/// range on the shared pool, see above
+template <typename Range, typename F>
+auto parallel_map(Range&& range, F&& fn, std::size_t grain = 0)
+    -> decltype(parallel_map(thread_pool::shared(), std::forward<Range>(range), std::forward<F>(fn), grain)) {
+    return parallel_map(thread_pool::shared(), std::forward<Range>(range), std::forward<F>(fn), grain);
+}
+
+} // namespace question_mark
+
+#endif //QUESTION_MARK_PARALLEL_HEADER
@@ -0,0 +1,301 @@
+#ifndef QUESTION_MARK_TELEMETRY_HEADER
+#define QUESTION_MARK_TELEMETRY_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// Number of distinct call sites counted per thread - events of further
+/// sites are only counted as dropped
+#ifndef QUESTION_MARK_TELEMETRY_SITES
+#define QUESTION_MARK_TELEMETRY_SITES 256
+#endif
+
+/// Recording stays out of line, so instrumented factories remain small
+#if defined(__GNUC__) || defined(__clang__)
+#define QUESTION_MARK_TELEMETRY_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define QUESTION_MARK_TELEMETRY_NOINLINE __declspec(noinline)
+#else
+#define QUESTION_MARK_TELEMETRY_NOINLINE
+#endif
+
+/// Call sites are captured by builtins evaluated in default arguments
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1927)
+#define QUESTION_MARK_CALLER_FILE __builtin_FILE()
+#define QUESTION_MARK_CALLER_LINE __builtin_LINE()
+#define QUESTION_MARK_CALLER_FUNCTION __builtin_FUNCTION()
+#else
+#define QUESTION_MARK_CALLER_FILE "unknown"
+#define QUESTION_MARK_CALLER_LINE 0
+#define QUESTION_MARK_CALLER_FUNCTION "unknown"
+#endif
+
+namespace question_mark {
+namespace telemetry {
+
+/// Kind of a counted event
+enum class event : unsigned char {
+    err,
+    none,
+    panic
+};
+
+inline const char* event_name(event kind) noexcept {
+    switch (kind) {
+        case event::err:
+            return "err";
+        case event::none:
+            return "none";
+        default:
+            return "panic";
+    }
+}
+
+/// Source location of a call, captured as default argument
+struct site {
+    const char* file;
+    unsigned line;
+    const char* function;
+
+    static constexpr site current(const char* file = QUESTION_MARK_CALLER_FILE,
+                                  unsigned line = QUESTION_MARK_CALLER_LINE,
+                                  const char* function = QUESTION_MARK_CALLER_FUNCTION) noexcept {
+        return site{file, line, function};
+    }
+};
+
+/// Number of events of a kind recorded at a call site
+struct site_count {
+    const char* file;
+    unsigned line;
+    const char* function;
+    event kind;
+    std::uint64_t count;
+};
+
+/// Counts of all threads aggregated by call site, most frequent first
+struct report {
+    std::vector<site_count> sites;
+    std::uint64_t dropped = 0;
+
+    /// One line per site: count, event, file:line and function
+    std::string to_text() const;
+
+    /// Object with the dropped count and an array of the sites
+    std::string to_json() const;
+};
+
+namespace detail {
+
+/// Counter of a call site - written only by the thread owning the table, so
+/// increments are plain relaxed stores, and published by storing the file
+struct counter {
+    std::atomic<const char*> file;
+    unsigned line;
+    const char* function;
+    event kind;
+    std::atomic<std::uint64_t> count;
+};
+
+/// Table of counters of a thread, padded so no other data shares its cache
+/// lines. Tables are never freed: when their thread exits they keep the
+/// counts and are reused by the next thread starting.
+struct thread_counters {
+    char front_padding[64];
+    counter counters[QUESTION_MARK_TELEMETRY_SITES];
+    std::atomic<std::uint64_t> dropped;
+    std::atomic<bool> owned;
+    thread_counters* next;
+    char back_padding[64];
+};
+
+/// Head of the lock-free list of all tables
+inline std::atomic<thread_counters*>& all_counters() noexcept {
+    static std::atomic<thread_counters*> head{nullptr};
+    return head;
+}
+
+inline thread_counters* claim_counters() {
+    auto& head = all_counters();
+    for (thread_counters* counters = head.load(std::memory_order_acquire); counters != nullptr;
+         counters = counters->next) {
+        bool expected = false;
+        if (!counters->owned.load(std::memory_order_relaxed)
+            && counters->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return counters;
+        }
+    }
+
+    auto* counters = new thread_counters();
+    counters->owned.store(true, std::memory_order_relaxed);
+    counters->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(counters->next, counters, std::memory_order_release,
+                                       std::memory_order_relaxed)) {}
+
+    return counters;
+}
+
+/// Claims a table for the calling thread and hands it over when it exits
+struct counters_owner {
+    thread_counters* counters = claim_counters();
+
+    ~counters_owner() {
+        counters->owned.store(false, std::memory_order_release);
+    }
+};
+
+inline thread_counters& local_counters() {
+    static thread_local counters_owner owner;
+    return *owner.counters;
+}
+
+inline void increment(std::atomic<std::uint64_t>& count) noexcept {
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline bool same_site(const site_count& left, const site_count& right) noexcept {
+    return left.line == right.line && left.kind == right.kind
+        && (left.file == right.file || std::strcmp(left.file, right.file) == 0);
+}
+
+inline bool site_less(const site_count& left, const site_count& right) noexcept {
+    if (left.line != right.line) {
+        return left.line < right.line;
+    }
+    if (left.kind != right.kind) {
+        return left.kind < right.kind;
+    }
+
+    return std::strcmp(left.file, right.file) < 0;
+}
+
+inline void append_json_string(std::string& out, const char* text) {
+    out += '"';
+    for (; *text != '\0'; ++text) {
+        char c = *text;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace detail
+
+/// Counts event at given call site in the table of the calling thread.
+/// Called by Err, None and failing unwraps when QUESTION_MARK_TELEMETRY is set.
+QUESTION_MARK_TELEMETRY_NOINLINE inline void record(const site& where, event kind) noexcept {
+    detail::thread_counters& counters = detail::local_counters();
+    std::size_t hash = (reinterpret_cast<std::uintptr_t>(where.file) >> 3) ^ (std::size_t(where.line) * 0x9e3779b1u)
+        ^ static_cast<std::size_t>(kind);
+
+    for (std::size_t probe = 0; probe < QUESTION_MARK_TELEMETRY_SITES; ++probe) {
+        detail::counter& counter = counters.counters[(hash + probe) % QUESTION_MARK_TELEMETRY_SITES];
+        const char* file = counter.file.load(std::memory_order_relaxed);
+        if (file == nullptr) {
+            counter.line = where.line;
+            counter.function = where.function;
+            counter.kind = kind;
+            counter.count.store(1, std::memory_order_relaxed);
+            counter.file.store(where.file, std::memory_order_release);
+            return;
+        }
+
+        if (file == where.file && counter.line == where.line && counter.kind == kind) {
+            detail::increment(counter.count);
+            return;
+        }
+    }
+
+    detail::increment(counters.dropped);
+}
+
+/// Sums counters of all threads, including the exited ones. Runs concurrently
+/// with the counting threads, whose latest events may be missed.
+inline report snapshot() {
+    report result;
+    for (auto* counters = detail::all_counters().load(std::memory_order_acquire); counters != nullptr;
+         counters = counters->next) {
+        for (const detail::counter& counter : counters->counters) {
+            const char* file = counter.file.load(std::memory_order_acquire);
+            if (file != nullptr) {
+                result.sites.push_back(site_count{file, counter.line, counter.function, counter.kind,
+                                                  counter.count.load(std::memory_order_relaxed)});
+            }
+        }
+        result.dropped += counters->dropped.load(std::memory_order_relaxed);
+    }
+
+    std::sort(result.sites.begin(), result.sites.end(), detail::site_less);
+    std::vector<site_count> merged;
+    for (const site_count& site : result.sites) {
+        if (!merged.empty() && detail::same_site(merged.back(), site)) {
+            merged.back().count += site.count;
+        } else {
+            merged.push_back(site);
+        }
+    }
+
+    std::stable_sort(merged.begin(), merged.end(), [](const site_count& left, const site_count& right) {
+        return left.count > right.count;
+    });
+    result.sites = std::move(merged);
+    return result;
+}
+
+inline std::string report::to_text() const {
+    std::string out;
+    char line[64];
+    for (const site_count& site : sites) {
+        std::snprintf(line, sizeof(line), "%12llu %-5s ", static_cast<unsigned long long>(site.count),
+                      event_name(site.kind));
+        out += line;
+        out += site.file;
+        std::snprintf(line, sizeof(line), ":%u ", site.line);
+        out += line;
+        out += site.function;
+        out += '\n';
+    }
+
+    if (dropped != 0) {
+        std::snprintf(line, sizeof(line), "%12llu dropped\n", static_cast<unsigned long long>(dropped));
+        out += line;
+    }
+
+    return out;
+}
+
+inline std::string report::to_json() const {
+    std::string out = "{\"dropped\":" + std::to_string(dropped) + ",\"sites\":[";
+    for (std::size_t i = 0; i < sites.size(); ++i) {
+        const site_count& site = sites[i];
+        out += i == 0 ? "{\"file\":" : ",{\"file\":";
+        detail::append_json_string(out, site.file);
+        out += ",\"line\":" + std::to_string(site.line) + ",\"function\":";
+        detail::append_json_string(out, site.function);
+        out += ",\"event\":\"";
+        out += event_name(site.kind);
+        out += "\",\"count\":" + std::to_string(site.count) + "}";
+    }
+    out += "]}";
+
+    return out;
+}
+
+} // namespace telemetry
+} // namespace question_mark
+
+#endif //QUESTION_MARK_TELEMETRY_HEADER
@@ -0,0 +1,831 @@
+#ifndef QUESTION_MARK_VECTOR_HEADER
+#define QUESTION_MARK_VECTOR_HEADER
+
+#include "question_mark.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/// Batch kernels use AVX2 when the target supports it, SSE2 otherwise and plain
+/// loops on other architectures or when QUESTION_MARK_NO_SIMD is defined
+#if defined(QUESTION_MARK_NO_SIMD)
+#define QUESTION_MARK_AVX2 0
+#define QUESTION_MARK_SSE2 0
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define QUESTION_MARK_AVX2 1
+#define QUESTION_MARK_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUESTION_MARK_AVX2 0
+#define QUESTION_MARK_SSE2 1
+#else
+#define QUESTION_MARK_AVX2 0
+#define QUESTION_MARK_SSE2 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace question_mark {
+namespace detail {
+
+constexpr std::size_t bits_per_word = 64;
+
+inline std::size_t words_for(std::size_t size) {
+    return (size + bits_per_word - 1) / bits_per_word;
+}
+
+inline std::size_t popcount(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return std::size_t(__builtin_popcountll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return std::size_t(__popcnt64(word));
+#else
+    std::size_t count = 0;
+    for (; word != 0; word &= word - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/// Index of the lowest set bit of a non-zero word
+inline std::size_t lowest_bit(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return std::size_t(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return std::size_t(index);
+#else
+    std::size_t index = 0;
+    for (; (word & 1) == 0; word >>= 1) {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+/// Calls fn with the index of every set bit. Full words are walked as plain
+/// loops, so dense bitmaps cost no more than visiting every element.
+template <typename F>
+void for_each_set_bit(const std::uint64_t* words, std::size_t count, F&& fn) {
+    for (std::size_t w = 0; w < count; ++w) {
+        std::size_t base = w * bits_per_word;
+        std::uint64_t word = words[w];
+        if (word == ~std::uint64_t(0)) {
+            for (std::size_t j = 0; j < bits_per_word; ++j) {
+                fn(base + j);
+            }
+            continue;
+        }
+
+        for (; word != 0; word &= word - 1) {
+            fn(base + lowest_bit(word));
+        }
+    }
+}
+
+/// Counts set bits of given words
+inline std::size_t count_bits(const std::uint64_t* words, std::size_t count) {
+    std::size_t total = 0;
+    std::size_t i = 0;
+#if QUESTION_MARK_AVX2
+    // Nibble lookup popcount accumulated with sum of absolute differences
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i sums = _mm256_setzero_si256();
+    for (; i + 4 <= count; i += 4) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(block, low_mask));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(block, 4), low_mask));
+        sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+    std::uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sums);
+    total = std::size_t(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+    for (; i < count; ++i) {
+        total += popcount(words[i]);
+    }
+
+    return total;
+}
+
+struct bit_and {
+    static std::uint64_t apply(std::uint64_t a, std::uint64_t b) {
+        return a & b;
+    }
+#if QUESTION_MARK_AVX2
+    static __m256i apply(__m256i a, __m256i b) {
+        return _mm256_and_si256(a, b);
+    }
+#endif
+#if QUESTION_MARK_SSE2
+    static __m128i apply(__m128i a, __m128i b) {
+        return _mm_and_si128(a, b);
+    }
+#endif
+};
+
+struct bit_or {
+    static std::uint64_t apply(std::uint64_t a, std::uint64_t b) {
+        return a | b;
+    }
+#if QUESTION_MARK_AVX2
+    static __m256i apply(__m256i a, __m256i b) {
+        return _mm256_or_si256(a, b);
+    }
+#endif
+#if QUESTION_MARK_SSE2
+    static __m128i apply(__m128i a, __m128i b) {
+        return _mm_or_si128(a, b);
+    }
+#endif
+};
+
+struct bit_xor {
+    static std::uint64_t apply(std::uint64_t a, std::uint64_t b) {
+        return a ^ b;
+    }
+#if QUESTION_MARK_AVX2
+    static __m256i apply(__m256i a, __m256i b) {
+        return _mm256_xor_si256(a, b);
+    }
+#endif
+#if QUESTION_MARK_SSE2
+    static __m128i apply(__m128i a, __m128i b) {
+        return _mm_xor_si128(a, b);
+    }
+#endif
+};
+
+/// Combines given words with Op
+template <typename Op>
+void combine_bits(const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out, std::size_t count) {
+    std::size_t i = 0;
+#if QUESTION_MARK_AVX2
+    for (; i + 4 <= count; i += 4) {
+        __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Op::apply(left, right));
+    }
+#endif
+#if QUESTION_MARK_SSE2
+    for (; i + 2 <= count; i += 2) {
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Op::apply(left, right));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = Op::apply(a[i], b[i]);
+    }
+}
+
+/// Reads word from memory holding a payload of another type
+template <typename W>
+W load_word(const W* ptr) {
+    W word;
+    std::memcpy(&word, ptr, sizeof(W));
+    return word;
+}
+
+/// Writes word into memory holding a payload of another type
+template <typename W>
+void store_word(W* ptr, W word) {
+    std::memcpy(ptr, &word, sizeof(W));
+}
+
+/// Fallback of select_bits taken from an array
+template <typename W>
+struct array_fallback {
+    const W* values;
+
+    W at(std::size_t i) const {
+        return load_word(values + i);
+    }
+#if QUESTION_MARK_AVX2
+    __m256i load256(std::size_t i) const {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+    }
+#endif
+#if QUESTION_MARK_SSE2
+    __m128i load128(std::size_t i) const {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    }
+#endif
+};
+
+/// Fallback of select_bits repeating a single value
+template <typename W>
+struct broadcast_fallback {
+    W value;
+
+    W at(std::size_t) const {
+        return value;
+    }
+#if QUESTION_MARK_AVX2
+    __m256i load256(std::size_t) const {
+        return sizeof(W) == 4 ? _mm256_set1_epi32(int(value)) : _mm256_set1_epi64x((long long)(value));
+    }
+#endif
+#if QUESTION_MARK_SSE2
+    __m128i load128(std::size_t) const {
+        return sizeof(W) == 4 ? _mm_set1_epi32(int(value)) : _mm_set1_epi64x((long long)(value));
+    }
+#endif
+};
+
+#if QUESTION_MARK_AVX2
+/// Expands 8 (32 bit lanes) or 4 (64 bit lanes) bits into lane masks
+template <typename W>
+__m256i expand256(std::uint64_t bits) {
+    if (sizeof(W) == 4) {
+        const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(int(bits)), lanes), lanes);
+    }
+
+    const __m256i lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+    return _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x((long long)(bits)), lanes), lanes);
+}
+#endif
+
+#if QUESTION_MARK_SSE2
+/// Expands 4 (32 bit lanes) or 2 (64 bit lanes) bits into lane masks
+template <typename W>
+__m128i expand128(std::uint64_t bits) {
+    const __m128i lanes = sizeof(W) == 4 ? _mm_setr_epi32(1, 2, 4, 8) : _mm_setr_epi32(1, 1, 2, 2);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(int(bits)), lanes), lanes);
+}
+#endif
+
+/// Writes values whose bit is set and fallback for the others - W is the
+/// 32 or 64 bit word the payload is reinterpreted as
+template <typename W, typename Fallback>
+void select_bits(const W* values, const std::uint64_t* bits, const Fallback& fallback, W* out, std::size_t size) {
+    std::size_t i = 0;
+    for (; i + bits_per_word <= size; i += bits_per_word) {
+        std::uint64_t word = bits[i / bits_per_word];
+        std::size_t j = 0;
+#if QUESTION_MARK_AVX2
+        for (; j < bits_per_word; j += 32 / sizeof(W)) {
+            __m256i mask = expand256<W>(word >> j);
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + j));
+            __m256i selected = _mm256_blendv_epi8(fallback.load256(i + j), value, mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + j), selected);
+        }
+#elif QUESTION_MARK_SSE2
+        for (; j < bits_per_word; j += 16 / sizeof(W)) {
+            __m128i mask = expand128<W>(word >> j);
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + j));
+            __m128i selected = _mm_or_si128(_mm_and_si128(mask, value), _mm_andnot_si128(mask, fallback.load128(i + j)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + j), selected);
+        }
+#endif
+        for (; j < bits_per_word; ++j) {
+            store_word(out + i + j, (word >> j) & 1 ? load_word(values + i + j) : fallback.at(i + j));
+        }
+    }
+
+    for (; i < size; ++i) {
+        bool set = (bits[i / bits_per_word] >> (i % bits_per_word)) & 1;
+        store_word(out + i, set ? load_word(values + i) : fallback.at(i));
+    }
+}
+
+/// 32-bit integers compared by the SIMD integer kernel
+template <typename T>
+using simd_equal_int32 = std::integral_constant<bool,
+    QUESTION_MARK_SSE2 && std::is_integral<T>::value && sizeof(T) == 4>;
+
+/// Compares 64 elements starting at values with needle using SIMD where the
+/// payload allows it, returns number of elements compared
+template <typename T>
+typename std::enable_if<!simd_equal_int32<T>::value, std::size_t>::type
+equal_word(const T*, const T&, std::uint64_t&) {
+    return 0;
+}
+
+#if QUESTION_MARK_SSE2
+inline std::size_t equal_word(const float* values, const float& needle, std::uint64_t& word) {
+#if QUESTION_MARK_AVX2
+    const __m256 wanted = _mm256_set1_ps(needle);
+    for (std::size_t j = 0; j < bits_per_word; j += 8) {
+        __m256 value = _mm256_loadu_ps(values + j);
+        word |= std::uint64_t(_mm256_movemask_ps(_mm256_cmp_ps(value, wanted, _CMP_EQ_OQ))) << j;
+    }
+#else
+    const __m128 wanted = _mm_set1_ps(needle);
+    for (std::size_t j = 0; j < bits_per_word; j += 4) {
+        __m128 value = _mm_loadu_ps(values + j);
+        word |= std::uint64_t(_mm_movemask_ps(_mm_cmpeq_ps(value, wanted))) << j;
+    }
+#endif
+    return bits_per_word;
+}
+
+template <typename T>
+typename std::enable_if<simd_equal_int32<T>::value, std::size_t>::type
+equal_word(const T* values, const T& needle, std::uint64_t& word) {
+#if QUESTION_MARK_AVX2
+    const __m256i wanted = _mm256_set1_epi32(int(needle));
+    for (std::size_t j = 0; j < bits_per_word; j += 8) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + j));
+        __m256i equal = _mm256_cmpeq_epi32(value, wanted);
+        word |= std::uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(equal))) << j;
+    }
+#else
+    const __m128i wanted = _mm_set1_epi32(int(needle));
+    for (std::size_t j = 0; j < bits_per_word; j += 4) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + j));
+        __m128i equal = _mm_cmpeq_epi32(value, wanted);
+        word |= std::uint64_t(_mm_movemask_ps(_mm_castsi128_ps(equal))) << j;
+    }
+#endif
+    return bits_per_word;
+}
+#endif
+
+/// Sets bits of elements equal to needle
+template <typename T>
+void equal_bits(const T* values, const T& needle, std::uint64_t* out, std::size_t size) {
+    for (std::size_t i = 0; i < size; i += bits_per_word) {
+        std::size_t count = std::min(bits_per_word, size - i);
+        std::uint64_t word = 0;
+        std::size_t j = count == bits_per_word ? equal_word(values + i, needle, word) : 0;
+        for (; j < count; ++j) {
+            word |= std::uint64_t(values[i + j] == needle) << j;
+        }
+        out[i / bits_per_word] = word;
+    }
+}
+
+/// Unsigned word a payload can be reinterpreted as by the select kernels
+template <typename T, typename = void>
+struct select_word {
+    using type = void;
+};
+
+template <typename T>
+struct select_word<T, typename std::enable_if<std::is_trivially_copyable<T>::value && sizeof(T) == 4>::type> {
+    using type = std::uint32_t;
+};
+
+template <typename T>
+struct select_word<T, typename std::enable_if<std::is_trivially_copyable<T>::value && sizeof(T) == 8>::type> {
+    using type = std::uint64_t;
+};
+
+template <typename T, typename Fallback>
+void select_values(const T* values, const std::uint64_t* bits, const Fallback& fallback, T* out,
+                   std::size_t size, std::false_type) {
+    for (std::size_t i = 0; i < size; ++i) {
+        out[i] = (bits[i / bits_per_word] >> (i % bits_per_word)) & 1 ? values[i] : fallback.at(i);
+    }
+}
+
+template <typename T, typename Fallback>
+void select_values(const T* values, const std::uint64_t* bits, const Fallback& fallback, T* out,
+                   std::size_t size, std::true_type) {
+    using W = typename select_word<T>::type;
+    select_bits(reinterpret_cast<const W*>(values), bits, fallback.template as<W>(), reinterpret_cast<W*>(out), size);
+}
+
+/// Fallback of select_values holding payloads before they are reinterpreted
+template <typename T>
+struct payload_array {
+    const T* values;
+
+    const T& at(std::size_t i) const {
+        return values[i];
+    }
+
+    template <typename W>
+    array_fallback<W> as() const {
+        return {reinterpret_cast<const W*>(values)};
+    }
+};
+
+template <typename T>
+struct payload_broadcast {
+    T value;
+
+    const T& at(std::size_t) const {
+        return value;
+    }
+
+    template <typename W>
+    broadcast_fallback<W> as() const {
+        W word;
+        std::memcpy(&word, &value, sizeof(W));
+        return {word};
+    }
+};
+
+/// Writes values whose bit is set and fallback for the others, using the
+/// SIMD kernels for 32 and 64 bit trivially copyable payloads
+template <typename T, typename Fallback>
+void select_values(const T* values, const std::uint64_t* bits, const Fallback& fallback, T* out, std::size_t size) {
+    using simd = std::integral_constant<bool, !std::is_void<typename select_word<T>::type>::value>;
+    select_values(values, bits, fallback, out, size, simd());
+}
+
+} // namespace detail
+
+/// Packed bitmap with a bit for each element of a batch. Bits past the size
+/// are always zero.
+class Bitmap {
+public:
+    Bitmap() = default;
+
+    /// Creates bitmap of given size with all bits set to given value
+    explicit Bitmap(std::size_t size, bool value = false)
+        : _words(detail::words_for(size), value ? ~std::uint64_t(0) : 0), _size(size) {
+        clear_tail();
+    }
+
+    std::size_t size() const {
+        return _size;
+    }
+
+    bool test(std::size_t i) const {
+        return (_words[i / detail::bits_per_word] >> (i % detail::bits_per_word)) & 1;
+    }
+
+    void set(std::size_t i, bool value) {
+        std::uint64_t bit = std::uint64_t(1) << (i % detail::bits_per_word);
+        std::uint64_t& word = _words[i / detail::bits_per_word];
+        word = value ? word | bit : word & ~bit;
+    }
+
+    void push_back(bool value) {
+        if (_size % detail::bits_per_word == 0) {
+            _words.push_back(0);
+        }
+        ++_size;
+        set(_size - 1, value);
+    }
+
+    void reserve(std::size_t size) {
+        _words.reserve(detail::words_for(size));
+    }
+
+    /// Counts set bits
+    std::size_t count() const {
+        return detail::count_bits(_words.data(), _words.size());
+    }
+
+    Bitmap operator& (const Bitmap& other) const {
+        return combine<detail::bit_and>(other);
+    }
+
+    Bitmap operator| (const Bitmap& other) const {
+        return combine<detail::bit_or>(other);
+    }
+
+    Bitmap operator^ (const Bitmap& other) const {
+        return combine<detail::bit_xor>(other);
+    }
+
+    Bitmap operator~ () const {
+        Bitmap result(_size, true);
+        detail::combine_bits<detail::bit_xor>(_words.data(), result._words.data(), result._words.data(), _words.size());
+        return result;
+    }
+
+    bool operator== (const Bitmap& other) const {
+        return _size == other._size && _words == other._words;
+    }
+
+    const std::uint64_t* words() const {
+        return _words.data();
+    }
+
+    std::uint64_t* words() {
+        return _words.data();
+    }
+
+    std::size_t word_count() const {
+        return _words.size();
+    }
+
+private:
+    template <typename Op>
+    Bitmap combine(const Bitmap& other) const {
+        assert(_size == other._size);
+        Bitmap result(_size);
+        detail::combine_bits<Op>(_words.data(), other._words.data(), result._words.data(), _words.size());
+        return result;
+    }
+
+    void clear_tail() {
+        if (_size % detail::bits_per_word != 0) {
+            _words.back() &= (std::uint64_t(1) << (_size % detail::bits_per_word)) - 1;
+        }
+    }
+
+    std::vector<std::uint64_t> _words;
+    std::size_t _size = 0;
+};
+
+/// Batch of Options stored as structure of arrays: the values contiguously and
+/// a validity bitmap next to them. Slots of None keep a value which is not
+/// specified, so bulk selections run without branches; functions given by the
+/// caller are only called with values of Some.
+template <typename T>
+class OptionVector {
+public:
+    OptionVector() = default;
+
+    /// Creates batch of given size containing only None
+    explicit OptionVector(std::size_t size) : _values(size), _valid(size) {}
+
+    /// Creates batch from given values and validity bitmap
+    OptionVector(std::vector<T> values, Bitmap valid) : _values(std::move(values)), _valid(std::move(valid)) {
+        assert(_values.size() == _valid.size());
+    }
+
+    /// Creates batch from vector of Options
+    static OptionVector from(const std::vector<Option<T>>& options) {
+        OptionVector batch;
+        batch.reserve(options.size());
+        for (const auto& option : options) {
+            batch.push_back(option);
+        }
+
+        return batch;
+    }
+
+    /// Converts batch into vector of Options
+    std::vector<Option<T>> to_vector() const {
+        std::vector<Option<T>> options;
+        options.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            options.push_back(get(i));
+        }
+
+        return options;
+    }
+
+    std::size_t size() const {
+        return _values.size();
+    }
+
+    void reserve(std::size_t size) {
+        _values.reserve(size);
+        _valid.reserve(size);
+    }
+
+    void push_back(const Option<T>& option) {
+        if (option.is_some()) {
+            push_some(option.unwrap());
+        } else {
+            push_none();
+        }
+    }
+
+    void push_some(T value) {
+        _values.push_back(std::move(value));
+        _valid.push_back(true);
+    }
+
+    void push_none() {
+        _values.emplace_back();
+        _valid.push_back(false);
+    }
+
+    /// Returns Option at given index
+    Option<T> get(std::size_t i) const {
+        return _valid.test(i) ? Option<T>::Some(_values[i]) : detail::make_none<T>();
+    }
+
+    /// Puts given Option at given index
+    void set(std::size_t i, Option<T> option) {
+        _valid.set(i, option.is_some());
+        if (option.is_some()) {
+            _values[i] = std::move(option).unwrap();
+        }
+    }
+
+    bool is_some(std::size_t i) const {
+        return _valid.test(i);
+    }
+
+    const std::vector<T>& values() const {
+        return _values;
+    }
+
+    const Bitmap& valid() const {
+        return _valid;
+    }
+
+    /// Counts elements containing value
+    std::size_t count_some() const {
+        return _valid.count();
+    }
+
+    /// Returns values with given one in place of None
+    std::vector<T> unwrap_or(const T& value) const {
+        std::vector<T> result(size());
+        detail::select_values(_values.data(), _valid.words(), detail::payload_broadcast<T>{value},
+                              result.data(), size());
+        return result;
+    }
+
+    /// Checks which elements contain given value
+    Bitmap contains(const T& value) const {
+        Bitmap equal(size());
+        detail::equal_bits(_values.data(), value, equal.words(), size());
+        return equal & _valid;
+    }
+
+    /// Maps values of Some with given function, slots of None stay None
+    template<typename F, typename U = question_mark::detail::call_result_t<F&, const T&>>
+    OptionVector<U> map(F&& fn) const {
+        std::vector<U> mapped(size());
+        detail::for_each_set_bit(_valid.words(), _valid.word_count(), [&](std::size_t i) {
+            mapped[i] = fn(_values[i]);
+        });
+
+        return OptionVector<U>(std::move(mapped), _valid);
+    }
+
+    /// Keeps only values of Some for which given predicate returns true
+    template<typename F>
+    OptionVector filter(F&& fn) const {
+        Bitmap kept(size());
+        std::uint64_t* words = kept.words();
+        detail::for_each_set_bit(_valid.words(), _valid.word_count(), [&](std::size_t i) {
+            words[i / detail::bits_per_word] |= std::uint64_t(bool(fn(_values[i]))) << (i % detail::bits_per_word);
+        });
+
+        return OptionVector(_values, std::move(kept));
+    }
+
+    /// Returns other values where both batches contain value and None elsewhere
+    template<typename U>
+    OptionVector<U> and_(const OptionVector<U>& other) const {
+        return OptionVector<U>(other.values(), _valid & other.valid());
+    }
+
+    /// Returns own values where present, values of other batch elsewhere
+    OptionVector or_(const OptionVector& other) const {
+        return OptionVector(select(other), _valid | other._valid);
+    }
+
+    /// Returns values present in exactly one of the batches
+    OptionVector xor_(const OptionVector& other) const {
+        return OptionVector(select(other), _valid ^ other._valid);
+    }
+
+    bool operator== (const OptionVector& other) const {
+        if (size() != other.size() || !(_valid == other._valid)) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < size(); ++i) {
+            if (_valid.test(i) && !(_values[i] == other._values[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<T> select(const OptionVector& other) const {
+        assert(size() == other.size());
+        std::vector<T> result(size());
+        detail::select_values(_values.data(), _valid.words(), detail::payload_array<T>{other._values.data()},
+                              result.data(), size());
+        return result;
+    }
+
+    std::vector<T> _values;
+    Bitmap _valid;
+};
+
+/// Batch of Results stored as structure of arrays: values, errors and a bitmap
+/// of successful elements. Slots not holding a value (or an error) keep one
+/// which is not specified.
+template <typename T, typename E>
+class ResultVector {
+public:
+    ResultVector() = default;
+
+    /// Creates batch from vector of Results
+    static ResultVector from(const std::vector<Result<T, E>>& results) {
+        ResultVector batch;
+        batch.reserve(results.size());
+        for (const auto& result : results) {
+            batch.push_back(result);
+        }
+
+        return batch;
+    }
+
+    /// Converts batch into vector of Results
+    std::vector<Result<T, E>> to_vector() const {
+        std::vector<Result<T, E>> results;
+        results.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            results.push_back(get(i));
+        }
+
+        return results;
+    }
+
+    std::size_t size() const {
+        return _values.size();
+    }
+
+    void reserve(std::size_t size) {
+        _values.reserve(size);
+        _errors.reserve(size);
+        _ok.reserve(size);
+    }
+
+    void push_back(const Result<T, E>& result) {
+        if (result.is_ok()) {
+            push_ok(result.unwrap());
+        } else {
+            push_err(result.unwrap_err());
+        }
+    }
+
+    void push_ok(T value) {
+        _values.push_back(std::move(value));
+        _errors.emplace_back();
+        _ok.push_back(true);
+    }
+
+    void push_err(E error) {
+        _values.emplace_back();
+        _errors.push_back(std::move(error));
+        _ok.push_back(false);
+    }
+
+    /// Returns Result at given index
+    Result<T, E> get(std::size_t i) const {
+        return _ok.test(i) ? Result<T, E>::Ok(_values[i]) : detail::make_err<T, E>(_errors[i]);
+    }
+
+    bool is_ok(std::size_t i) const {
+        return _ok.test(i);
+    }
+
+    /// Counts successful elements
+    std::size_t count_ok() const {
+        return _ok.count();
+    }
+
+    /// Returns values as Options - None in place of errors
+    OptionVector<T> ok() const {
+        return OptionVector<T>(_values, _ok);
+    }
+
+    /// Returns errors as Options - None in place of values
+    OptionVector<E> err() const {
+        return OptionVector<E>(_errors, ~_ok);
+    }
+
+    /// Returns values with given one in place of errors
+    std::vector<T> unwrap_or(const T& value) const {
+        std::vector<T> result(size());
+        detail::select_values(_values.data(), _ok.words(), detail::payload_broadcast<T>{value}, result.data(), size());
+        return result;
+    }
+
+    /// Maps successful values with given function, errors are kept
+    template<typename F, typename U = question_mark::detail::call_result_t<F&, const T&>>
+    ResultVector<U, E> map(F&& fn) const {
+        std::vector<U> mapped(size());
+        detail::for_each_set_bit(_ok.words(), _ok.word_count(), [&](std::size_t i) {
+            mapped[i] = fn(_values[i]);
+        });
+
+        return ResultVector<U, E>(std::move(mapped), _errors, _ok);
+    }
+
+private:
+    template <typename, typename>
+    friend class ResultVector;
+
+    ResultVector(std::vector<T> values, std::vector<E> errors, Bitmap ok)
+        : _values(std::move(values)), _errors(std::move(errors)), _ok(std::move(ok)) {}
+
+    std::vector<T> _values;
+    std::vector<E> _errors;
+    Bitmap _ok;
+};
+
+} // namespace question_mark
+
+#endif //QUESTION_MARK_VECTOR_HEADER
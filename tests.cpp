@@ -1,8 +1,274 @@
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "external/catch2.hpp"
 #include "question_mark.hpp"
+#include "question_mark_atomic.hpp"
+#include "question_mark_box.hpp"
+#include "question_mark_error.hpp"
+#include "question_mark_iter.hpp"
+#include "question_mark_parallel.hpp"
+#include "question_mark_telemetry.hpp"
+#include "question_mark_vector.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace tests {
+    /// Number of global operator new calls made so far - by all threads
+    std::atomic<std::size_t> allocations{0};
+}
+
+/// The replacements pair malloc with free. They stay out of line, so GCC does
+/// not see free called on pointers of new expressions and warn about it.
+#if defined(__GNUC__) || defined(__clang__)
+#define QUESTION_MARK_TESTS_NOINLINE __attribute__((noinline))
+#else
+#define QUESTION_MARK_TESTS_NOINLINE
+#endif
+
+QUESTION_MARK_TESTS_NOINLINE void* operator new(std::size_t size) {
+    ++tests::allocations;
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+QUESTION_MARK_TESTS_NOINLINE void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+QUESTION_MARK_TESTS_NOINLINE void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
 
 namespace tests {
+    /// Enum reserving its last value as a none representation
+    enum class Color : unsigned char {
+        Red,
+        Green,
+        Blue,
+        Invalid = 0xff
+    };
+
+    /// Error carrying no data
+    struct Failed {
+        bool operator== (const Failed&) const {
+            return true;
+        }
+    };
+
+    /// Codes of the parse error domain
+    enum class ParseError {
+        InvalidDigit = 1,
+        Overflow
+    };
+
+    const question_mark::error_domain& parse_errors() {
+        static const char* const messages[] = {"no error", "invalid digit", "overflow"};
+        static const question_mark::error_domain domain("parse", messages);
+        return domain;
+    }
+}
+
+namespace question_mark {
+    template <>
+    struct option_traits<tests::Color> : sentinel_option_traits<tests::Color, tests::Color::Invalid> {};
+
+    template <>
+    struct error_traits<tests::ParseError> {
+        static const error_domain& domain() {
+            return tests::parse_errors();
+        }
+    };
+}
+
+namespace tests {
+    /// Number of copies and moves made by Tracker objects
+    struct {
+        int copies = 0;
+        int moves = 0;
+    } tracked;
+
+    /// Payload counting its copies and moves
+    struct Tracker {
+        Tracker() = default;
+
+        Tracker(const Tracker&) {
+            ++tracked.copies;
+        }
+
+        Tracker(Tracker&&) noexcept {
+            ++tracked.moves;
+        }
+
+        Tracker& operator= (const Tracker&) {
+            ++tracked.copies;
+            return *this;
+        }
+
+        Tracker& operator= (Tracker&&) noexcept {
+            ++tracked.moves;
+            return *this;
+        }
+
+        bool operator== (const Tracker&) const {
+            return true;
+        }
+    };
+
+    /// Payload whose copies throw while throwing_copies is set
+    bool throwing_copies = false;
+
+    struct ThrowingCopy {
+        std::string text;
+
+        ThrowingCopy(std::string text) : text(std::move(text)) {}
+
+        ThrowingCopy(const ThrowingCopy& other) : text(other.text) {
+            if (throwing_copies) {
+                throw std::runtime_error("copy failed");
+            }
+        }
+
+        ThrowingCopy(ThrowingCopy&&) noexcept = default;
+        ThrowingCopy& operator= (const ThrowingCopy&) = default;
+        ThrowingCopy& operator= (ThrowingCopy&&) noexcept = default;
+
+        bool operator== (const ThrowingCopy& other) const {
+            return text == other.text;
+        }
+    };
+
+    /// Doubles given value - usable in constant expressions also before C++17
+    struct Twice {
+        constexpr int operator() (int value) const {
+            return value * 2;
+        }
+    };
+
+    /// Looks up port of given service
+    constexpr Option<int> port_of(char service) {
+        return service == 'h' ? Option<int>::Some(80) : Option<int>::None();
+    }
+
+    /// Ports looked up at compile time
+    constexpr int ports[] = {port_of('h').unwrap_or(0), port_of('x').unwrap_or(0)};
+
+    /// Parses decimal digit
+    Result<int, std::string> parse_digit(char digit) {
+        if (digit < '0' || digit > '9') {
+            return Result<int, std::string>::Err(std::string("not a digit"));
+        }
+
+        return Result<int, std::string>::Ok(digit - '0');
+    }
+
+    /// Parses decimal number propagating errors of its digits
+    Result<int, std::string> parse_number(const std::string& text) {
+        int number = 0;
+        for (char digit : text) {
+            TRY(int value, parse_digit(digit));
+            number = number * 10 + value;
+        }
+
+        return Result<int, std::string>::Ok(number);
+    }
+
+    /// Doubles first digit of given text propagating None
+    Option<int> twice_first_digit(const std::string& text) {
+        TRY(int value, parse_digit(text[0]).ok());
+        return Option<int>::Some(value * 2);
+    }
+
+    /// Propagates error of given result
+    Result<long, Tracker> forward_error(Result<int, Tracker> result) {
+        TRY(long value, std::move(result));
+        return Result<long, Tracker>::Ok(value);
+    }
+
+    /// Resource counting allocations forwarded to the default one
+    class CountingResource : public question_mark::memory_resource {
+    public:
+        std::size_t allocated = 0;
+        std::size_t deallocated = 0;
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            allocated += bytes;
+            return question_mark::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+            deallocated += bytes;
+            question_mark::new_delete_resource()->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const question_mark::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    /// Node of a list built out of boxed options
+    struct Node {
+        int value;
+        question_mark::BoxedOption<Node> next;
+    };
+
+    /// Payload too large to be kept inline by CompactOption
+    struct Large {
+        char data[1024];
+    };
+
+    /// Message of the last panic reported to record_panic
+    std::string last_panic;
+
+    /// Panic handler remembering the message before throwing
+    void record_panic(const char* message) {
+        last_panic = message;
+        question_mark::throw_on_panic(message);
+    }
+
+#if QUESTION_MARK_HAS_COROUTINES
+    /// Sums two digits awaiting their parsing
+    Result<int, std::string> sum_digits(char first, char second) {
+        int left = co_await parse_digit(first);
+        int right = co_await parse_digit(second);
+        co_return left + right;
+    }
+
+    /// Parses digit and returns Result directly
+    Result<int, std::string> parse_digit_again(char digit) {
+        auto result = parse_digit(digit);
+        co_return result;
+    }
+
+    /// Error without a default constructor
+    struct Rejected {
+        explicit Rejected(char digit) : digit(digit) {}
+
+        bool operator== (const Rejected& other) const {
+            return digit == other.digit;
+        }
+
+        char digit;
+    };
+
+    /// Sums two digits rejecting the first one which is not a digit
+    Result<int, Rejected> sum_checked(char first, char second) {
+        auto check = [](char digit) {
+            return parse_digit(digit).is_ok() ? Result<int, Rejected>::Ok(digit - '0')
+                                              : Result<int, Rejected>::Err(Rejected(digit));
+        };
+        int left = co_await check(first);
+        int right = co_await check(second);
+        co_return left + right;
+    }
+#endif
+
     TEST_CASE("check Option's methods", "[Option<T>]") {
         SECTION("is_some") {
             REQUIRE(Option<int>::Some(10).is_some());
@@ -47,18 +313,18 @@ namespace tests {
         }
 
         SECTION("map") {
-            REQUIRE(Option<std::string>::Some(std::string("test")).map<int>([](auto s){return s.length();}) == Option<int>::Some(4));
-            REQUIRE(Option<std::string>::None().map<int>([](auto s){return s.length();}) == Option<int>::None());
+            REQUIRE(Option<std::string>::Some(std::string("test")).map([](auto s){return s.length();}) == Option<std::size_t>::Some(4));
+            REQUIRE(Option<std::string>::None().map([](auto s){return s.length();}) == Option<std::size_t>::None());
         }
 
         SECTION("map_or") {
-            REQUIRE(Option<std::string>::Some(std::string("test")).map_or<int>(10, [](auto s){return s.length();}) == Option<int>::Some(4));
-            REQUIRE(Option<std::string>::None().map_or<int>(10, [](auto s){return s.length();}) == Option<int>::Some(10));
+            REQUIRE(Option<std::string>::Some(std::string("test")).map_or(10, [](auto s){return s.length();}) == Option<int>::Some(4));
+            REQUIRE(Option<std::string>::None().map_or(10, [](auto s){return s.length();}) == Option<int>::Some(10));
         }
 
         SECTION("map_or_else") {
-            REQUIRE(Option<std::string>::Some(std::string("test")).map_or_else<int>([]{return 10;}, [](auto s){return s.length();}) == Option<int>::Some(4));
-            REQUIRE(Option<std::string>::None().map_or_else<int>([]{return 10;}, [](auto s){return s.length();}) == Option<int>::Some(10));
+            REQUIRE(Option<std::string>::Some(std::string("test")).map_or_else([]{return 10;}, [](auto s){return s.length();}) == Option<std::size_t>::Some(4));
+            REQUIRE(Option<std::string>::None().map_or_else([]{return 10;}, [](auto s){return s.length();}) == Option<std::size_t>::Some(10));
         }
 
         SECTION("ok_or") {
@@ -67,9 +333,8 @@ namespace tests {
         }
 
         SECTION("ok_or_else") {
-            REQUIRE(Option<int>::Some(10).ok_or_else<int>([]{return 20;}) == Result<int, int>::Ok(10)); // todo: compiler cannot deduct
-            REQUIRE(Option<int>::None().ok_or_else<int>([]{return 20;}) == Result<int, int>::Err(20));  //       type of returning value
-                                                                                                        //       from lambda
+            REQUIRE(Option<int>::Some(10).ok_or_else([]{return 20;}) == Result<int, int>::Ok(10));
+            REQUIRE(Option<int>::None().ok_or_else([]{return 20;}) == Result<int, int>::Err(20));
         }
 
         SECTION("and") {
@@ -80,10 +345,10 @@ namespace tests {
         }
 
         SECTION("and_then") {
-            REQUIRE(Option<int>::Some(10).and_then<int>([]{return Option<int>::Some(20);}) == Option<int>::Some(20)); // todo: compiler cannot deduct
-            REQUIRE(Option<int>::None().and_then<int>([]{return Option<int>::Some(20);}) == Option<int>::None());     //       type of returning value
-            REQUIRE(Option<int>::None().and_then<int>([]{return Option<int>::None();}) == Option<int>::None());       //       from lambda
-            REQUIRE(Option<int>::Some(10).and_then<int>([]{return Option<int>::None();}) == Option<int>::None());
+            REQUIRE(Option<int>::Some(10).and_then([]{return Option<int>::Some(20);}) == Option<int>::Some(20));
+            REQUIRE(Option<int>::None().and_then([]{return Option<int>::Some(20);}) == Option<int>::None());
+            REQUIRE(Option<int>::None().and_then([]{return Option<int>::None();}) == Option<int>::None());
+            REQUIRE(Option<int>::Some(10).and_then([]{return Option<int>::None();}) == Option<int>::None());
         }
 
         SECTION("filter") {
@@ -101,10 +366,10 @@ namespace tests {
         }
 
         SECTION("or_else") {
-            REQUIRE(Option<int>::Some(10).or_else<int>([](){return Option<int>::Some(20);}) == Option<int>::Some(10)); // todo: compiler cannot deduct
-            REQUIRE(Option<int>::None().or_else<int>([](){return Option<int>::Some(20);}) == Option<int>::Some(20));   //       type of returning value
-            REQUIRE(Option<int>::None().or_else<int>([](){return Option<int>::None();}) == Option<int>::None());       //       from lambda
-            REQUIRE(Option<int>::Some(10).or_else<int>([](){return Option<int>::None();}) == Option<int>::Some(10));
+            REQUIRE(Option<int>::Some(10).or_else([](){return Option<int>::Some(20);}) == Option<int>::Some(10));
+            REQUIRE(Option<int>::None().or_else([](){return Option<int>::Some(20);}) == Option<int>::Some(20));
+            REQUIRE(Option<int>::None().or_else([](){return Option<int>::None();}) == Option<int>::None());
+            REQUIRE(Option<int>::Some(10).or_else([](){return Option<int>::None();}) == Option<int>::Some(10));
         }
 
         SECTION("xor") {
@@ -113,6 +378,94 @@ namespace tests {
             REQUIRE(Option<int>::None().xor_(Option<int>::None()) == Option<int>::None());
             REQUIRE(Option<int>::Some(10).xor_(Option<int>::None()) == Option<int>::Some(10));
         }
+
+        SECTION("take") {
+            auto some = Option<int>::Some(10);
+            REQUIRE(some.take() == Option<int>::Some(10));
+            REQUIRE(some.is_none());
+            REQUIRE(some.take() == Option<int>::None());
+        }
+
+        SECTION("replace") {
+            auto some = Option<int>::Some(10);
+            REQUIRE(some.replace(20) == Option<int>::Some(10));
+            REQUIRE(some == Option<int>::Some(20));
+
+            auto none = Option<int>::None();
+            REQUIRE(none.replace(30) == Option<int>::None());
+            REQUIRE(none == Option<int>::Some(30));
+        }
+
+        SECTION("chained combinators") {
+            auto twice = [](int value){return value * 2;};
+            auto fallback = []{return Option<int>::Some(30);};
+            REQUIRE(Option<int>::Some(10).map(twice).filter([](int value){return value > 10;}).unwrap_or(0) == 20);
+            REQUIRE(Option<int>::None().map(twice).or_else(fallback).unwrap_or(0) == 30);
+        }
+
+        SECTION("inline storage") {
+            STATIC_REQUIRE(sizeof(Option<int>) <= sizeof(int) * 2);
+            STATIC_REQUIRE(sizeof(Option<double>) == sizeof(double) * 2);
+            STATIC_REQUIRE(std::is_trivially_copyable<Option<int>>::value);
+            STATIC_REQUIRE_FALSE(std::is_trivially_copyable<Option<std::string>>::value);
+        }
+
+        SECTION("no allocations") {
+            std::size_t before = allocations;
+            auto some = Option<int>::Some(10);
+            auto none = Option<int>::None();
+            REQUIRE(some.unwrap_or(20) + none.unwrap_or(20) == 30);
+            REQUIRE(allocations == before);
+        }
+
+        SECTION("niche layout") {
+            STATIC_REQUIRE(sizeof(Option<Color>) == sizeof(Color));
+            STATIC_REQUIRE(sizeof(Option<int&>) == sizeof(int*));
+            STATIC_REQUIRE(sizeof(Option<int*>) == sizeof(int*));
+            STATIC_REQUIRE(sizeof(Option<const void*>) == sizeof(void*));
+            STATIC_REQUIRE(sizeof(Option<std::unique_ptr<int>>) == sizeof(std::unique_ptr<int>));
+            STATIC_REQUIRE(std::is_trivially_copyable<Option<int*>>::value);
+        }
+
+        SECTION("niche values") {
+            REQUIRE(Option<Color>::Some(Color::Blue).unwrap() == Color::Blue);
+            REQUIRE(Option<Color>::None().is_none());
+        }
+
+        SECTION("null pointers are values") {
+            int value = 10;
+            REQUIRE(Option<int*>::Some(&value).contains(&value));
+            REQUIRE(Option<int*>::None().is_none());
+            REQUIRE(Option<int*>::Some(nullptr).is_some());
+            REQUIRE(Option<std::unique_ptr<int>>::Some(std::unique_ptr<int>()).is_some());
+
+            auto ptr = Option<std::unique_ptr<int>>::Some(std::make_unique<int>(10));
+            auto taken = ptr.take();
+            REQUIRE(ptr.is_none());
+            REQUIRE(*std::move(taken).unwrap() == 10);
+
+            auto none = Option<std::unique_ptr<int>>::None();
+            auto moved = std::move(none);
+            REQUIRE(none.is_none());
+            REQUIRE(moved.is_none());
+            REQUIRE(moved.replace(std::make_unique<int>(3)).is_none());
+            REQUIRE(*moved.as_ref().unwrap() == 3);
+            moved = std::move(none);
+            REQUIRE(moved.is_none());
+        }
+
+        SECTION("copy and move") {
+            auto some = Option<std::string>::Some(std::string("test"));
+            auto copy = some;
+            auto moved = std::move(some);
+            REQUIRE(copy.contains("test"));
+            REQUIRE(moved.contains("test"));
+
+            copy = Option<std::string>::None();
+            REQUIRE(copy.is_none());
+            copy = moved;
+            REQUIRE(copy.contains("test"));
+        }
     }
 
     TEST_CASE("check Result's methods", "[Result<T,E>]") {
@@ -146,9 +499,1047 @@ namespace tests {
             REQUIRE_FALSE(Result<int, int>::Err(10) == Result<int, int>::Err(20));
         }
 
+        SECTION("tagged union layout") {
+            STATIC_REQUIRE(sizeof(Result<int, int>) == 8);
+            STATIC_REQUIRE(sizeof(Result<char, char>) == 2);
+            STATIC_REQUIRE(std::is_trivially_copyable<Result<int, int>>::value);
+            STATIC_REQUIRE_FALSE(std::is_trivially_copyable<Result<std::string, int>>::value);
+        }
+
+        SECTION("niche layout") {
+            STATIC_REQUIRE(sizeof(Result<Color, Failed>) == sizeof(Color));
+            STATIC_REQUIRE(sizeof(Result<Failed, Color>) == sizeof(Color));
+            STATIC_REQUIRE(sizeof(Result<int&, Failed>) == sizeof(int*));
+            STATIC_REQUIRE(sizeof(Result<int*, Failed>) == sizeof(int*));
+            STATIC_REQUIRE(sizeof(Result<std::unique_ptr<int>, Failed>) == sizeof(std::unique_ptr<int>));
+            STATIC_REQUIRE(sizeof(Result<int*, int>) == sizeof(int*) * 2);
+        }
+
+        SECTION("niche values") {
+            REQUIRE(Result<Color, Failed>::Ok(Color::Green).contains(Color::Green));
+            REQUIRE(Result<Color, Failed>::Err(Failed()).contains_err(Failed()));
+            REQUIRE(Result<Failed, Color>::Ok(Failed()).is_ok());
+            REQUIRE(Result<Failed, Color>::Err(Color::Red).contains_err(Color::Red));
+            REQUIRE(Result<Color, Failed>::Ok(Color::Blue).ok() == Option<Color>::Some(Color::Blue));
+        }
+
+        SECTION("null pointers are values") {
+            int value = 10;
+            REQUIRE(Result<int*, Failed>::Ok(&value).contains(&value));
+            REQUIRE(Result<int*, Failed>::Ok(nullptr).is_ok());
+            REQUIRE(Result<int*, Failed>::Err(Failed()).is_err());
+            REQUIRE(Result<Failed, int*>::Err(nullptr).is_err());
+            REQUIRE(Result<std::unique_ptr<int>, Failed>::Ok(nullptr).is_ok());
+            REQUIRE(Result<std::unique_ptr<int>, Failed>::Err(Failed()).is_err());
+            REQUIRE(*Result<std::unique_ptr<int>, Failed>::Ok(std::make_unique<int>(4)).unwrap() == 4);
+        }
+
+        SECTION("no allocations") {
+            std::size_t before = allocations;
+            auto ok = Result<int, int>::Ok(10);
+            auto err = Result<int, int>::Err(20);
+            REQUIRE(ok.contains(10));
+            REQUIRE(err.contains_err(20));
+            REQUIRE(allocations == before);
+        }
+
+        SECTION("copy and move") {
+            auto ok = Result<std::string, std::string>::Ok(std::string("value"));
+            auto err = Result<std::string, std::string>::Err(std::string("error"));
+            auto copy = ok;
+            REQUIRE(copy.contains("value"));
+
+            copy = err;
+            REQUIRE(copy.contains_err("error"));
+            REQUIRE(err.contains_err("error"));
+
+            copy = std::move(ok);
+            REQUIRE(copy.contains("value"));
+        }
+
+        SECTION("failed assignment keeps the payload") {
+            auto result = Result<std::string, ThrowingCopy>::Ok(std::string("value"));
+            auto err = Result<std::string, ThrowingCopy>::Err(ThrowingCopy("error"));
+            throwing_copies = true;
+            REQUIRE_THROWS_AS(result = err, std::runtime_error);
+            throwing_copies = false;
+            REQUIRE(result.contains("value"));
+
+            result = err;
+            REQUIRE(result.contains_err(ThrowingCopy("error")));
+        }
+
         SECTION("ok") {
-//            Result<int, int>::Ok(10).asd(10);
-//            REQUIRE(Result<int, int>::Ok(10).ok() == Option<int>::Some(10));
+            REQUIRE(Result<int, int>::Ok(10).ok() == Option<int>::Some(10));
+            REQUIRE(Result<int, int>::Err(10).ok() == Option<int>::None());
+        }
+
+        SECTION("err") {
+            REQUIRE(Result<int, int>::Err(10).err() == Option<int>::Some(10));
+            REQUIRE(Result<int, int>::Ok(10).err() == Option<int>::None());
+        }
+
+        SECTION("unwrap") {
+            REQUIRE(Result<int, int>::Ok(10).unwrap() == 10);
+            REQUIRE(Result<int, int>::Ok(10).expect("") == 10);
+            REQUIRE(Result<int, int>::Err(10).unwrap_err() == 10);
+        }
+
+        SECTION("unwrap_or") {
+            REQUIRE(Result<int, int>::Ok(10).unwrap_or(20) == 10);
+            REQUIRE(Result<int, int>::Err(10).unwrap_or(20) == 20);
+        }
+    }
+
+    TEST_CASE("check error propagation", "[Option<T>][Result<T,E>]") {
+        SECTION("Result") {
+            REQUIRE(parse_number("123") == Result<int, std::string>::Ok(123));
+            REQUIRE(parse_number("1x3") == Result<int, std::string>::Err(std::string("not a digit")));
+        }
+
+        SECTION("Option") {
+            REQUIRE(twice_first_digit("4") == Option<int>::Some(8));
+            REQUIRE(twice_first_digit("x") == Option<int>::None());
+        }
+
+        SECTION("moves error") {
+            tracked.copies = 0;
+            REQUIRE(forward_error(Result<int, Tracker>::Err(Tracker())).is_err());
+            REQUIRE(forward_error(Result<int, Tracker>::Ok(10)).contains(10));
+            REQUIRE(tracked.copies == 0);
+        }
+
+#if QUESTION_MARK_HAS_COROUTINES
+        SECTION("co_await") {
+            REQUIRE(sum_digits('1', '2') == Result<int, std::string>::Ok(3));
+            REQUIRE(sum_digits('x', '2') == Result<int, std::string>::Err(std::string("not a digit")));
+            REQUIRE(sum_digits('1', 'x') == Result<int, std::string>::Err(std::string("not a digit")));
+            REQUIRE(parse_digit_again('7') == Result<int, std::string>::Ok(7));
+            REQUIRE(sum_checked('4', '5').contains(9));
+            REQUIRE(sum_checked('4', 'x').contains_err(Rejected('x')));
+        }
+#endif
+    }
+
+    TEST_CASE("check panics", "[Option<T>][Result<T,E>]") {
+        using question_mark::panic_error;
+
+        auto previous = question_mark::set_panic_handler(question_mark::throw_on_panic);
+        REQUIRE(previous == &question_mark::exit_on_panic);
+
+        auto none = Option<int>::None();
+        auto err = Result<int, std::string>::Err("failed");
+
+        SECTION("failed accessors call the handler") {
+            REQUIRE_THROWS_AS(none.unwrap(), panic_error);
+            REQUIRE_THROWS_WITH(Option<int>::None().unwrap(), "Option::unwrap() called on a None");
+            REQUIRE_THROWS_WITH(none.expect("no value"), "no value");
+            REQUIRE_THROWS_WITH(none.expect(std::string("no string")), "no string");
+            REQUIRE_THROWS_WITH(err.unwrap(), "Result::unwrap() called on an Err");
+            REQUIRE_THROWS_WITH((Result<int, int>::Ok(1).unwrap_err()), "Result::unwrap_err() called on an Ok");
+            REQUIRE_THROWS_WITH(std::move(err).expect("no data"), "no data");
+        }
+
+        SECTION("sentinels can not be stored as values") {
+            REQUIRE_THROWS_AS(Option<Color>::Some(Color::Invalid), panic_error);
+            REQUIRE_THROWS_AS((Result<Color, Failed>::Ok(Color::Invalid)), panic_error);
+            REQUIRE_THROWS_AS((Result<Failed, Color>::Err(Color::Invalid)), panic_error);
+            auto color = Option<Color>::None();
+            REQUIRE_THROWS_AS(color.replace(Color::Invalid), panic_error);
+        }
+
+        SECTION("handler can be replaced by a callback") {
+            question_mark::set_panic_handler(record_panic);
+            REQUIRE_THROWS_AS(none.expect("recorded"), panic_error);
+            REQUIRE(last_panic == "recorded");
+            REQUIRE(question_mark::get_panic_handler() == &record_panic);
+        }
+
+        SECTION("unchecked accessors") {
+            REQUIRE(Option<int>::Some(1).unwrap_unchecked() == 1);
+            REQUIRE(Option<std::string>::Some("a").expect_unchecked("no value") == "a");
+            REQUIRE(Result<int, int>::Ok(2).unwrap_unchecked() == 2);
+            REQUIRE(Result<std::string, int>::Ok("b").expect_unchecked("no data") == "b");
+#if QUESTION_MARK_CHECK_UNCHECKED
+            REQUIRE_THROWS_WITH(none.unwrap_unchecked(), "Option::unwrap_unchecked() called on a None");
+            REQUIRE_THROWS_WITH(err.expect_unchecked("unchecked"), "unchecked");
+#endif
+        }
+
+        question_mark::set_panic_handler(nullptr);
+        REQUIRE(question_mark::get_panic_handler() == &question_mark::exit_on_panic);
+    }
+
+    TEST_CASE("check copies and moves of payloads", "[Option<T>][Result<T,E>]") {
+        tracked.copies = 0;
+        tracked.moves = 0;
+
+        SECTION("consuming temporaries never copies") {
+            Option<Tracker>::Some(Tracker()).unwrap();
+            Option<Tracker>::Some(Tracker()).expect("");
+            Option<Tracker>::Some(Tracker()).unwrap_or(Tracker());
+            Option<Tracker>::Some(Tracker()).map([](Tracker value){return value;});
+            Option<Tracker>::Some(Tracker()).ok_or(0);
+            Option<Tracker>::Some(Tracker()).filter([](const Tracker&){return true;});
+            Option<Tracker>::Some(Tracker()).or_(Option<Tracker>::None());
+            Option<Tracker>::Some(Tracker()).xor_(Option<Tracker>::None());
+            Result<Tracker, int>::Ok(Tracker()).ok();
+            Result<int, Tracker>::Err(Tracker()).err();
+            REQUIRE(tracked.copies == 0);
+        }
+
+        SECTION("borrowing copies only the returned payload") {
+            auto some = Option<Tracker>::Some(Tracker());
+            some.unwrap();
+            REQUIRE(tracked.copies == 1);
+
+            some.map([](const Tracker&){return 0;});
+            some.filter([](const Tracker&){return false;});
+            REQUIRE(tracked.copies == 1);
+
+            some.ok_or(0);
+            REQUIRE(tracked.copies == 2);
+            REQUIRE(some.is_some());
+        }
+
+        SECTION("take and replace move the payload") {
+            auto some = Option<Tracker>::Some(Tracker());
+            auto taken = some.take();
+            some.replace(Tracker());
+            REQUIRE(taken.is_some());
+            REQUIRE(some.is_some());
+            REQUIRE(tracked.copies == 0);
+        }
+    }
+
+    TEST_CASE("check borrowed payloads", "[Option<T>][Result<T,E>]") {
+        SECTION("Option of a reference refers to the object") {
+            int number = 1;
+            auto ref = Option<int&>::Some(number);
+            REQUIRE(sizeof(ref) == sizeof(int*));
+            REQUIRE(&ref.unwrap() == &number);
+
+            ref.unwrap() = 2;
+            REQUIRE(number == 2);
+            REQUIRE(ref.contains(2));
+            REQUIRE(ref.map([](int& value){return value * 2;}) == Option<int>::Some(4));
+
+            auto copy = ref;
+            copy.unwrap() = 3;
+            REQUIRE(number == 3);
+            REQUIRE(copy.take().is_some());
+            REQUIRE(copy.is_none());
+            REQUIRE(Option<int&>::None().unwrap_or(number) == 3);
+        }
+
+        SECTION("Result of references refers to the objects") {
+            int number = 1;
+            std::string error = "failed";
+            auto ok = Result<int&, std::string&>::Ok(number);
+            auto err = Result<int&, std::string&>::Err(error);
+            REQUIRE(&ok.unwrap() == &number);
+            REQUIRE(&err.unwrap_err() == &error);
+            REQUIRE(ok.contains(1));
+            REQUIRE(err.contains_err("failed"));
+            REQUIRE(sizeof(Result<Tracker&, Failed>) == sizeof(Tracker*));
+        }
+
+        SECTION("as_ref and as_mut borrow the payload") {
+            auto some = Option<std::string>::Some("text");
+            auto none = Option<std::string>::None();
+            REQUIRE(some.as_ref().map([](const std::string& text){return text.size();}) == Option<std::size_t>::Some(4));
+            REQUIRE(none.as_ref().is_none());
+
+            some.as_mut().unwrap() += "!";
+            REQUIRE(some.contains("text!"));
+
+            auto err = Result<int, std::string>::Err("x");
+            err.as_mut().unwrap_err() += "y";
+            REQUIRE(err.contains_err("xy"));
+            REQUIRE(&err.as_ref().unwrap_err() == &err.as_mut().unwrap_err());
+        }
+
+        SECTION("read-only pipelines never copy the payload") {
+            const auto some = Option<Tracker>::Some(Tracker());
+            const auto ok = Result<Tracker, int>::Ok(Tracker());
+            tracked.copies = 0;
+
+            some.contains(Tracker());
+            some.map([](const Tracker&){return 0;});
+            some.as_ref().map([](const Tracker&){return 0;});
+            some.as_ref().filter([](const Tracker&){return true;}).unwrap();
+            some.as_ref().ok_or(0).unwrap();
+            for (const Tracker& value : some.iter()) {
+                REQUIRE(some.contains(value));
+            }
+            ok.contains(Tracker());
+            ok.as_ref().unwrap();
+            ok.as_ref().ok().unwrap();
+            REQUIRE(tracked.copies == 0);
+        }
+    }
+
+    TEST_CASE("check compile-time evaluation", "[Option<T>][Result<T,E>]") {
+        SECTION("Option") {
+            STATIC_REQUIRE(Option<int>::Some(10).is_some());
+            STATIC_REQUIRE(Option<int>::None().is_none());
+            STATIC_REQUIRE(Option<int>::Some(10).unwrap() == 10);
+            STATIC_REQUIRE(Option<int>::Some(10).unwrap_or(20) == 10);
+            STATIC_REQUIRE(Option<int>::None().unwrap_or(20) == 20);
+            STATIC_REQUIRE(Option<int>::Some(10).map(Twice()) == Option<int>::Some(20));
+            STATIC_REQUIRE(Option<int>::None().map(Twice()) == Option<int>::None());
+            STATIC_REQUIRE(Option<Color>::Some(Color::Red).contains(Color::Red));
+            STATIC_REQUIRE(ports[0] == 80);
+            STATIC_REQUIRE(ports[1] == 0);
+        }
+
+        SECTION("Result") {
+            STATIC_REQUIRE(Result<int, int>::Ok(10).is_ok());
+            STATIC_REQUIRE(Result<int, int>::Err(10).is_err());
+            STATIC_REQUIRE(Result<int, int>::Ok(10) == Result<int, int>::Ok(10));
+            STATIC_REQUIRE_FALSE(Result<int, int>::Ok(10) == Result<int, int>::Err(10));
+            STATIC_REQUIRE(Result<int, int>::Err(10).err() == Option<int>::Some(10));
+            STATIC_REQUIRE(Option<int>::None().ok_or(20) == Result<int, int>::Err(20));
+        }
+
+#if __cplusplus >= 201703L
+        SECTION("lambdas") {
+            STATIC_REQUIRE(Option<int>::Some(10).map([](int value){return value + 1;}).unwrap_or(0) == 11);
+            STATIC_REQUIRE(Option<int>::None().ok_or_else([]{return 20;}) == Result<int, int>::Err(20));
+        }
+#endif
+
+#if QUESTION_MARK_HAS_CONSTEXPR_DYNAMIC_ALLOC
+        SECTION("non-trivial payloads") {
+            STATIC_REQUIRE([]{
+                auto values = Option<std::vector<int>>::Some(std::vector<int>{1, 2, 3});
+                auto previous = values.replace(std::vector<int>{4});
+                return previous.map([](const std::vector<int>& value){return value.size();}).unwrap_or(0);
+            }() == 3);
+            STATIC_REQUIRE(Result<std::vector<int>, int>::Ok(std::vector<int>{1}).ok().is_some());
+        }
+#endif
+    }
+
+    TEST_CASE("check OptionVector's methods", "[OptionVector<T>]") {
+        using question_mark::Bitmap;
+        using question_mark::OptionVector;
+
+        std::vector<Option<float>> options;
+        std::vector<Option<float>> others;
+        for (int i = 0; i < 1000; ++i) {
+            options.push_back(i % 3 == 0 ? Option<float>::None() : Option<float>::Some(float(i % 7)));
+            others.push_back(i % 5 == 0 ? Option<float>::None() : Option<float>::Some(float(-i)));
+        }
+        auto batch = OptionVector<float>::from(options);
+        auto other = OptionVector<float>::from(others);
+
+        SECTION("conversion") {
+            REQUIRE(batch.size() == options.size());
+            REQUIRE(batch.to_vector() == options);
+            REQUIRE(batch.get(3) == Option<float>::None());
+            REQUIRE(batch.get(4) == Option<float>::Some(4.0f));
+        }
+
+        SECTION("count_some") {
+            REQUIRE(batch.count_some() == 666);
+            REQUIRE(OptionVector<int>(130).count_some() == 0);
+        }
+
+        SECTION("unwrap_or") {
+            auto values = batch.unwrap_or(-1.0f);
+            for (std::size_t i = 0; i < options.size(); ++i) {
+                REQUIRE(values[i] == options[i].unwrap_or(-1.0f));
+            }
+        }
+
+        SECTION("contains") {
+            auto found = batch.contains(4.0f);
+            for (std::size_t i = 0; i < options.size(); ++i) {
+                REQUIRE(found.test(i) == options[i].contains(4.0f));
+            }
+        }
+
+        SECTION("contains of 32-bit integers") {
+            auto check = [](auto needle) {
+                using T = decltype(needle);
+                std::vector<Option<T>> values;
+                for (int i = 0; i < 200; ++i) {
+                    values.push_back(i % 4 == 0 ? Option<T>::None() : Option<T>::Some(T(i % 7)));
+                }
+                auto found = OptionVector<T>::from(values).contains(needle);
+                std::size_t count = 0;
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    REQUIRE(found.test(i) == values[i].contains(needle));
+                    count += found.test(i);
+                }
+                REQUIRE(count == 22);
+            };
+            check(std::int32_t(3));
+            check(std::uint32_t(3));
+        }
+
+        SECTION("map") {
+            auto mapped = batch.map([](float value){return double(value) * 2;});
+            for (std::size_t i = 0; i < options.size(); ++i) {
+                REQUIRE(mapped.get(i) == options[i].map([](float value){return double(value) * 2;}));
+            }
+        }
+
+        SECTION("functions only see values of Some") {
+            std::vector<Option<int>> divisors;
+            for (int i = 0; i < 200; ++i) {
+                divisors.push_back(i % 3 == 0 ? Option<int>::None() : Option<int>::Some(i));
+            }
+            auto ints = OptionVector<int>::from(divisors);
+            std::size_t calls = 0;
+            auto quotients = ints.map([&](int value){
+                ++calls;
+                return 1000 / value;
+            });
+            REQUIRE(calls == ints.count_some());
+            REQUIRE(quotients.get(1) == Option<int>::Some(1000));
+            REQUIRE(quotients.get(3).is_none());
+
+            calls = 0;
+            auto kept = ints.filter([&](int value){
+                ++calls;
+                return 1000 / value > 10;
+            });
+            REQUIRE(calls == ints.count_some());
+            REQUIRE(kept.count_some() == 60);
+        }
+
+        SECTION("filter") {
+            auto filtered = batch.filter([](float value){return value > 3.0f;});
+            for (std::size_t i = 0; i < options.size(); ++i) {
+                REQUIRE(filtered.get(i) == options[i].filter([](float value){return value > 3.0f;}));
+            }
+        }
+
+        SECTION("and, or, xor") {
+            auto both = batch.and_(other);
+            auto any = batch.or_(other);
+            auto one = batch.xor_(other);
+            for (std::size_t i = 0; i < options.size(); ++i) {
+                REQUIRE(both.get(i) == options[i].and_(others[i]));
+                REQUIRE(any.get(i) == options[i].or_(others[i]));
+                REQUIRE(one.get(i) == options[i].xor_(others[i]));
+            }
+        }
+
+        SECTION("other payloads") {
+            std::vector<Option<std::int64_t>> numbers;
+            std::vector<Option<std::string>> names;
+            for (int i = 0; i < 200; ++i) {
+                numbers.push_back(i % 2 == 0 ? Option<std::int64_t>::Some(i) : Option<std::int64_t>::None());
+                names.push_back(i % 4 == 0 ? Option<std::string>::Some(std::to_string(i)) : Option<std::string>::None());
+            }
+
+            auto number_values = OptionVector<std::int64_t>::from(numbers).unwrap_or(-1);
+            auto name_values = OptionVector<std::string>::from(names).unwrap_or("none");
+            for (std::size_t i = 0; i < numbers.size(); ++i) {
+                REQUIRE(number_values[i] == numbers[i].unwrap_or(-1));
+                REQUIRE(name_values[i] == names[i].unwrap_or("none"));
+            }
+            REQUIRE(OptionVector<std::int64_t>::from(numbers).contains(10).count() == 1);
+            REQUIRE(OptionVector<std::string>::from(names).contains("8").count() == 1);
+        }
+
+        SECTION("bitmap") {
+            Bitmap bits(100, true);
+            REQUIRE(bits.count() == 100);
+            REQUIRE((~bits).count() == 0);
+            bits.set(10, false);
+            REQUIRE((bits ^ Bitmap(100, true)).count() == 1);
+        }
+    }
+
+    TEST_CASE("check ResultVector's methods", "[ResultVector<T,E>]") {
+        using question_mark::ResultVector;
+
+        std::vector<Result<int, int>> results;
+        for (int i = 0; i < 300; ++i) {
+            results.push_back(i % 4 == 0 ? Result<int, int>::Err(-i) : Result<int, int>::Ok(i));
+        }
+        auto batch = ResultVector<int, int>::from(results);
+
+        REQUIRE(batch.to_vector() == results);
+        REQUIRE(batch.count_ok() == 225);
+        REQUIRE(batch.ok().count_some() == 225);
+        REQUIRE(batch.err().count_some() == 75);
+
+        auto values = batch.unwrap_or(0);
+        auto mapped = batch.map([](int value){return value + 1;});
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            REQUIRE(values[i] == results[i].unwrap_or(0));
+            REQUIRE(mapped.get(i).ok() == results[i].ok().map([](int value){return value + 1;}));
+            REQUIRE(batch.err().get(i) == results[i].err());
+        }
+
+        std::size_t calls = 0;
+        batch.map([&](int value){
+            ++calls;
+            return 1000 / value;
+        });
+        REQUIRE(calls == batch.count_ok());
+    }
+
+    TEST_CASE("check iterator adapters", "[Option<T>][Result<T,E>]") {
+        using question_mark::collect;
+        using question_mark::filter_map;
+        using question_mark::flatten;
+        using question_mark::try_fold;
+
+        tracked.copies = 0;
+        tracked.moves = 0;
+
+        SECTION("iter visits the value only when present") {
+            auto some = Option<int>::Some(5);
+            auto none = Option<int>::None();
+            int sum = 0;
+            for (int& value : some.iter()) {
+                value += 1;
+                sum += value;
+            }
+            for (int value : none.iter()) {
+                sum += value;
+            }
+            REQUIRE(sum == 6);
+            REQUIRE(some == Option<int>::Some(6));
+            REQUIRE(none.iter().empty());
+
+            auto ok = Result<int, std::string>::Ok(1);
+            auto err = Result<int, std::string>::Err("failed");
+            REQUIRE(ok.iter().size() == 1);
+            REQUIRE(*ok.iter().begin() == 1);
+            REQUIRE(err.iter().size() == 0);
+
+            auto color = Option<Color>::Some(Color::Red);
+            REQUIRE(color.iter().size() == 1);
+        }
+
+        SECTION("flatten and filter_map skip empty elements") {
+            std::vector<Option<int>> options = {Option<int>::Some(1), Option<int>::None(), Option<int>::Some(3)};
+            std::vector<int> values;
+            for (int value : flatten(options)) {
+                values.push_back(value);
+            }
+            REQUIRE(values == std::vector<int>{1, 3});
+
+            std::vector<Result<int, Failed>> results = {
+                Result<int, Failed>::Err(Failed()), Result<int, Failed>::Ok(2), Result<int, Failed>::Err(Failed())};
+            auto flattened = flatten(results);
+            REQUIRE(std::vector<int>(flattened.begin(), flattened.end()) == std::vector<int>{2});
+
+            int calls = 0;
+            auto digits = filter_map(std::string("a1b22"), [&](char c) {
+                ++calls;
+                return parse_digit(c).ok();
+            });
+            REQUIRE(calls == 0);
+            REQUIRE(std::vector<int>(digits.begin(), digits.end()) == std::vector<int>{1, 2, 2});
+            REQUIRE(calls == 5);
+        }
+
+        SECTION("collect stops at the first failure") {
+            std::vector<Result<int, std::string>> results = {
+                parse_digit('1'), parse_digit('x'), parse_digit('2'), parse_digit('y')};
+            REQUIRE(collect(results) == Result<std::vector<int>, std::string>::Err("not a digit"));
+            results.erase(results.begin() + 1, results.end());
+            REQUIRE(collect(results) == Result<std::vector<int>, std::string>::Ok({1}));
+
+            std::vector<Option<int>> options = {Option<int>::Some(1), Option<int>::Some(2)};
+            REQUIRE(collect(options) == Option<std::vector<int>>::Some({1, 2}));
+            options.push_back(Option<int>::None());
+            REQUIRE(collect(options).is_none());
+
+            std::vector<Option<Tracker>> trackers(3, Option<Tracker>::Some(Tracker()));
+            trackers[1] = Option<Tracker>::None();
+            trackers.push_back(Option<Tracker>::Some(Tracker()));
+            tracked.copies = 0;
+            REQUIRE(collect(trackers).is_none());
+            REQUIRE(tracked.copies == 1);
+        }
+
+        SECTION("collect moves out of temporaries and allocates once") {
+            std::vector<Result<Tracker, int>> results(100, Result<Tracker, int>::Ok(Tracker()));
+            tracked.copies = 0;
+            tracked.moves = 0;
+            std::size_t before = allocations;
+            auto collected = collect(std::move(results));
+            REQUIRE(collected.is_ok());
+            REQUIRE(allocations - before == 1);
+            REQUIRE(tracked.copies == 0);
+            REQUIRE(tracked.moves == 100);
+        }
+
+        SECTION("try_fold stops at the first failure") {
+            std::vector<int> numbers = {1, 2, 3, 4};
+            int calls = 0;
+            auto add_small = [&](int sum, int value) {
+                ++calls;
+                return value < 3 ? Option<int>::Some(sum + value) : Option<int>::None();
+            };
+            REQUIRE(try_fold(numbers, 0, add_small).is_none());
+            REQUIRE(calls == 3);
+
+            auto add_digit = [](int sum, char c) -> Result<int, std::string> {
+                TRY(int digit, parse_digit(c));
+                return Result<int, std::string>::Ok(sum + digit);
+            };
+            REQUIRE(try_fold(std::string("123"), 0, add_digit) == Result<int, std::string>::Ok(6));
+            REQUIRE(try_fold(std::string("1x3"), 0, add_digit) == Result<int, std::string>::Err("not a digit"));
+        }
+    }
+
+    TEST_CASE("check boxed payloads", "[Box<T>]") {
+        using question_mark::Box;
+        using question_mark::BoxedOption;
+        using question_mark::BoxedResult;
+
+        SECTION("boxes own values allocated from a resource") {
+            CountingResource resource;
+            {
+                auto box = Box<std::string>::make_in(resource, "boxed");
+                REQUIRE(*box == "boxed");
+                REQUIRE(box->size() == 5);
+                REQUIRE(box.resource() == &resource);
+
+                auto copy = box;
+                REQUIRE(copy == box);
+                REQUIRE(copy.get() != box.get());
+                REQUIRE(resource.allocated == 2 * sizeof(std::string));
+
+                auto moved = std::move(copy);
+                REQUIRE(copy.get() == nullptr);
+                REQUIRE(*moved == "boxed");
+            }
+            REQUIRE(resource.deallocated == resource.allocated);
+        }
+
+        SECTION("boxed options are as large as a box") {
+            STATIC_REQUIRE(sizeof(BoxedOption<Large>) == sizeof(Box<Large>));
+            STATIC_REQUIRE(sizeof(BoxedResult<Large, Failed>) == sizeof(Box<Large>));
+
+            auto some = BoxedOption<int>::Some(Box<int>::make(5));
+            REQUIRE(*some.unwrap() == 5);
+            REQUIRE(some.map([](const Box<int>& value){return *value + 1;}) == Option<int>::Some(6));
+            REQUIRE(BoxedOption<int>::None().is_none());
+            REQUIRE(some.take().is_some());
+            REQUIRE(some.is_none());
+
+            auto ok = BoxedResult<int, Failed>::Ok(Box<int>::make(1));
+            REQUIRE(ok.is_ok());
+            REQUIRE(BoxedResult<int, Failed>::Err(Failed()).is_err());
+        }
+
+        SECTION("arena frees all payloads at once") {
+            question_mark::monotonic_arena arena(1024);
+            std::size_t before = allocations;
+            Node list{0, BoxedOption<Node>::None()};
+            for (int i = 1; i <= 100; ++i) {
+                list = Node{i, BoxedOption<Node>::Some(Box<Node>::make_in(arena, std::move(list)))};
+            }
+            REQUIRE(allocations - before < 10);
+
+            int sum = 0;
+            for (const Node* node = &list; node != nullptr; ) {
+                sum += node->value;
+                node = node->next.is_some() ? node->next.iter().begin()->get() : nullptr;
+            }
+            REQUIRE(sum == 5050);
+
+            std::size_t capacity = arena.capacity();
+            list = Node{0, BoxedOption<Node>::None()};
+            arena.reset();
+            REQUIRE(arena.capacity() <= capacity);
+            REQUIRE(*Box<int>::make_in(arena, 7) == 7);
+            arena.release();
+            REQUIRE(arena.capacity() == 0);
+        }
+
+        SECTION("compact payloads are boxed above the threshold") {
+            STATIC_REQUIRE(std::is_same<question_mark::payload_t<int>, int>::value);
+            STATIC_REQUIRE(std::is_same<question_mark::payload_t<Large>, Box<Large>>::value);
+            STATIC_REQUIRE(std::is_same<question_mark::CompactOption<Large, 2048>, Option<Large>>::value);
+            STATIC_REQUIRE(sizeof(question_mark::CompactOption<Large>) == sizeof(Box<Large>));
+
+            question_mark::monotonic_arena arena;
+            auto small = question_mark::make_payload<int>(arena, 3);
+            auto large = question_mark::make_payload<Large>(arena);
+            REQUIRE(small == 3);
+            REQUIRE(large.resource() == &arena);
+        }
+    }
+
+    TEST_CASE("check error codes", "[Error]") {
+        using question_mark::Error;
+
+        SECTION("errors are small and allocation free") {
+            STATIC_REQUIRE(sizeof(Error) == 8);
+            STATIC_REQUIRE(std::is_trivially_copyable<Error>::value);
+            STATIC_REQUIRE(sizeof(Result<int, Error>) <= 2 * sizeof(void*));
+
+            std::size_t before = allocations;
+            auto result = Result<int, Error>::Err(ParseError::Overflow);
+            REQUIRE(result.contains_err(ParseError::Overflow));
+            REQUIRE_FALSE(result.contains_err(ParseError::InvalidDigit));
+            REQUIRE(result.unwrap_err().context("parsing").context("loading") == ParseError::Overflow);
+            REQUIRE(allocations == before);
+        }
+
+        SECTION("messages come from the domain") {
+            Error error = ParseError::InvalidDigit;
+            REQUIRE(&error.domain() == &parse_errors());
+            REQUIRE(error.code() == 1);
+            REQUIRE(std::string(error.message()) == "invalid digit");
+            REQUIRE(error.to_string() == "parse: invalid digit");
+            REQUIRE(Error(parse_errors(), 7).to_string() == "parse: unknown error");
+            REQUIRE(Error().to_string() == "error: unknown error");
+            REQUIRE(Error(parse_errors(), 2) == ParseError::Overflow);
+        }
+
+        SECTION("contexts are chained outermost first") {
+            auto inner = [] {
+                return question_mark::with_context(Result<int, Error>::Err(ParseError::Overflow), "reading header");
+            };
+            auto outer = [&]() -> Result<int, Error> {
+                TRY(int value, question_mark::with_context(inner(), "loading config"));
+                return Result<int, Error>::Ok(value);
+            };
+
+            Error error = outer().unwrap_err();
+            REQUIRE(error.to_string() == "loading config: reading header: parse: overflow");
+
+            char buffer[16];
+            REQUIRE(error.format(buffer, sizeof(buffer)) == error.to_string().size());
+            REQUIRE(std::string(buffer) == "loading config:");
+            REQUIRE(question_mark::with_context(Result<int, Error>::Ok(1), "unused").unwrap() == 1);
+        }
+
+        SECTION("overwritten contexts are dropped") {
+            Error error = Error(ParseError::Overflow).context("stale");
+            for (int i = 0; i < 100; ++i) {
+                Error(ParseError::InvalidDigit).context("newer");
+            }
+            REQUIRE(error.to_string() == "parse: overflow");
+        }
+
+        SECTION("contexts added on another thread are dropped") {
+            Error error;
+            std::thread worker([&] {
+                error = Error(ParseError::Overflow).context("worker context");
+                REQUIRE(error.to_string() == "worker context: parse: overflow");
+            });
+            worker.join();
+
+            std::string text;
+            std::thread reader([&] {
+                Error(ParseError::InvalidDigit).context("reader context");
+                text = error.to_string();
+            });
+            reader.join();
+            REQUIRE(text == "parse: overflow");
+        }
+
+        SECTION("contexts are not confused after the old 16-bit sequence wrapped") {
+            Error error = Error(ParseError::Overflow).context("stale");
+            for (int i = 0; i < 0x10000; ++i) {
+                Error(ParseError::InvalidDigit).context("newer");
+            }
+            REQUIRE(error.to_string() == "parse: overflow");
+            REQUIRE(error.context("fresh").to_string() == "fresh: parse: overflow");
+        }
+    }
+
+    /// Hands values 1 to count per producer through given slot to as many
+    /// consumers, returns sum of the taken values
+    template <typename T, typename Make, typename Read>
+    long long hand_over(question_mark::AtomicOption<T>& slot, int threads, int count, Make make, Read read) {
+        std::atomic<int> remaining{threads * count};
+        std::atomic<long long> sum{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                for (int i = 1; i <= count; ++i) {
+                    T value = make(i);
+                    while (!slot.compare_and_set_if_none(std::move(value))) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            workers.emplace_back([&] {
+                while (remaining.load() > 0) {
+                    auto taken = slot.take();
+                    if (taken.is_some()) {
+                        sum += read(std::move(taken).unwrap());
+                        --remaining;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        return sum.load();
+    }
+
+    TEST_CASE("check AtomicOption's methods", "[AtomicOption<T>]") {
+        using question_mark::AtomicOption;
+
+        SECTION("small and pointer payloads are lock-free") {
+            STATIC_REQUIRE(AtomicOption<int>::is_always_lock_free);
+            STATIC_REQUIRE(AtomicOption<Color>::is_always_lock_free);
+            STATIC_REQUIRE(AtomicOption<const char*>::is_always_lock_free);
+            STATIC_REQUIRE(AtomicOption<std::unique_ptr<std::string>>::is_always_lock_free);
+            STATIC_REQUIRE_FALSE(AtomicOption<std::string>::is_always_lock_free);
+
+            std::atomic<Option<int>> slot(Option<int>::Some(1));
+            REQUIRE(slot.is_lock_free());
+        }
+
+        SECTION("take, replace and compare_and_set_if_none") {
+            AtomicOption<int> slot;
+            REQUIRE(slot.is_none());
+            REQUIRE(slot.replace(1).is_none());
+            REQUIRE(slot.is_some());
+            REQUIRE(slot.load() == Option<int>::Some(1));
+            REQUIRE_FALSE(slot.compare_and_set_if_none(2));
+            REQUIRE(slot.replace(3) == Option<int>::Some(1));
+            REQUIRE(slot.take() == Option<int>::Some(3));
+            REQUIRE(slot.take().is_none());
+            REQUIRE(slot.compare_and_set_if_none(4));
+            REQUIRE(slot.take(std::memory_order_acquire) == Option<int>::Some(4));
+        }
+
+        SECTION("null pointers are values") {
+            AtomicOption<int*> slot;
+            REQUIRE(slot.compare_and_set_if_none(nullptr));
+            REQUIRE(slot.is_some());
+            REQUIRE(slot.load() == Option<int*>::Some(nullptr));
+            REQUIRE(slot.take() == Option<int*>::Some(nullptr));
+            REQUIRE(slot.is_none());
+
+            AtomicOption<std::unique_ptr<int>> owned;
+            REQUIRE(owned.replace(std::unique_ptr<int>()).is_none());
+            REQUIRE(owned.take().is_some());
+        }
+
+        SECTION("unique pointers are owned by the slot") {
+            AtomicOption<std::unique_ptr<std::string>> slot(Option<std::unique_ptr<std::string>>::Some(
+                std::unique_ptr<std::string>(new std::string("first"))));
+            auto second = std::unique_ptr<std::string>(new std::string("second"));
+            REQUIRE_FALSE(slot.compare_and_set_if_none(std::move(second)));
+            REQUIRE(second != nullptr);
+            REQUIRE(*slot.replace(std::move(second)).unwrap() == "first");
+            REQUIRE(*slot.take().unwrap() == "second");
+            REQUIRE(slot.is_none());
+            REQUIRE(slot.compare_and_set_if_none(std::unique_ptr<std::string>(new std::string("third"))));
+        }
+
+        SECTION("large payloads are guarded by a spinlock") {
+            AtomicOption<std::string> slot;
+            std::string value = "kept";
+            REQUIRE(slot.compare_and_set_if_none(value));
+            REQUIRE_FALSE(slot.compare_and_set_if_none(std::string("lost")));
+            REQUIRE(slot.load() == Option<std::string>::Some("kept"));
+            REQUIRE(slot.replace("next").unwrap() == "kept");
+            REQUIRE(slot.take().unwrap() == "next");
+        }
+
+        SECTION("values are handed over exactly once between threads") {
+            constexpr int threads = 4;
+            constexpr int count = 2000;
+            constexpr long long expected = threads * (count * (count + 1LL) / 2);
+
+            AtomicOption<int> ints;
+            REQUIRE(hand_over(ints, threads, count, [](int i){return i;}, [](int i){return i;}) == expected);
+
+            AtomicOption<std::unique_ptr<int>> pointers;
+            REQUIRE(hand_over(pointers, threads, count,
+                              [](int i){return std::unique_ptr<int>(new int(i));},
+                              [](std::unique_ptr<int> i){return *i;}) == expected);
+
+            AtomicOption<std::string> strings;
+            REQUIRE(hand_over(strings, threads, count,
+                              [](int i){return std::to_string(i);},
+                              [](std::string i){return std::stoi(i);}) == expected);
+        }
+    }
+
+    /// Value without default constructor
+    struct Wrapped {
+        explicit Wrapped(int value) : value(value) {}
+
+        int value;
+    };
+
+    TEST_CASE("check parallel map", "[Result<T,E>]") {
+        using question_mark::parallel_map;
+        using question_mark::thread_pool;
+
+        std::vector<int> inputs(10000);
+        for (int i = 0; i < int(inputs.size()); ++i) {
+            inputs[i] = i;
+        }
+        thread_pool pool(4);
+
+        SECTION("values are collected in input order") {
+            auto squares = parallel_map(pool, inputs, [](int i) {
+                return Result<long, std::string>::Ok(long(i) * i);
+            });
+            REQUIRE(squares.is_ok());
+            auto values = squares.unwrap();
+            REQUIRE(values.size() == inputs.size());
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                REQUIRE(values[i] == long(i) * long(i));
+            }
+
+            auto empty = parallel_map(std::vector<int>(), [](int i) {
+                return Result<int, Failed>::Ok(i);
+            });
+            REQUIRE(empty.unwrap().empty());
+        }
+
+        SECTION("the error of the lowest index is returned") {
+            std::atomic<std::size_t> calls{0};
+            auto result = parallel_map(pool, inputs, [&](int i) {
+                ++calls;
+                return i % 1000 == 999 ? Result<int, int>::Err(i) : Result<int, int>::Ok(i);
+            }, 16);
+            REQUIRE(result.contains_err(999));
+            // every participant meets an error within 1000 elements of its share
+            REQUIRE(calls < inputs.size() / 2);
+
+            thread_pool single(1);
+            calls = 0;
+            auto first = parallel_map(single, inputs, [&](int i) {
+                ++calls;
+                return i == 10 ? Result<int, int>::Err(i) : Result<int, int>::Ok(i);
+            });
+            REQUIRE(first.contains_err(10));
+            REQUIRE(calls == 11);
+        }
+
+        SECTION("pools of any size give the same outcome") {
+            for (unsigned concurrency : {1u, 2u, 7u}) {
+                thread_pool sized(concurrency);
+                REQUIRE(sized.concurrency() == concurrency);
+                auto wrapped = parallel_map(sized, inputs, [](int i) {
+                    return Result<Wrapped, Failed>::Ok(Wrapped(i + 1));
+                }, 3);
+                REQUIRE(wrapped.unwrap()[9999].value == 10000);
+            }
+        }
+
+        SECTION("nested maps run on the calling participant") {
+            auto sums = parallel_map(pool, std::vector<int>{10, 20, 30}, [&](int count) {
+                auto parts = parallel_map(pool, std::vector<int>(count, 1), [](int i) {
+                    return Result<int, Failed>::Ok(i);
+                });
+                return Result<std::size_t, Failed>::Ok(parts.unwrap().size());
+            });
+            REQUIRE(sums.unwrap() == std::vector<std::size_t>{10, 20, 30});
+        }
+
+        SECTION("exceptions are rethrown") {
+            REQUIRE_THROWS_AS(parallel_map(pool, inputs, [](int i) {
+                if (i == 5000) {
+                    throw std::runtime_error("failed");
+                }
+                return Result<int, int>::Ok(i);
+            }), std::runtime_error);
+        }
+    }
+
+#if QUESTION_MARK_TELEMETRY
+    /// Number of events of given kind counted at given line of this file
+    std::uint64_t recorded(question_mark::telemetry::event kind, unsigned line) {
+        for (const auto& site : question_mark::telemetry::snapshot().sites) {
+            if (site.kind == kind && site.line == line && std::string(site.file).find("tests.cpp") != std::string::npos) {
+                return site.count;
+            }
+        }
+
+        return 0;
+    }
+
+    /// Number of events counted inside the library headers
+    std::uint64_t recorded_in_headers() {
+        std::uint64_t count = 0;
+        for (const auto& site : question_mark::telemetry::snapshot().sites) {
+            if (std::string(site.file).find(".hpp") != std::string::npos) {
+                count += site.count;
+            }
+        }
+
+        return count;
+    }
+
+    TEST_CASE("check telemetry counters", "[telemetry]") {
+        using question_mark::telemetry::event;
+
+        SECTION("call sites are counted per event") {
+            unsigned line = __LINE__ + 2;
+            for (int i = 0; i < 3; ++i) {
+                Result<int, int>::Err(i); Option<int>::None(); Result<int, int>::Ok(i);
+            }
+            REQUIRE(recorded(event::err, line) == 3);
+            REQUIRE(recorded(event::none, line) == 3);
+            REQUIRE(recorded(event::panic, line) == 0);
+        }
+
+        SECTION("values made by the library are not counted") {
+            REQUIRE(Result<int, int>::Ok(1).err().is_none());
+            REQUIRE(Option<int>::Some(1).filter([](int value) { return value > 1; }).is_none());
+            REQUIRE(Option<int>::Some(1).xor_(Option<int>::Some(2)).is_none());
+            unsigned line = __LINE__ + 1;
+            auto failed = Result<int, int>::Err(1);
+            REQUIRE(failed.as_ref().is_err());
+            REQUIRE(parse_number("1x").is_err());
+            REQUIRE(twice_first_digit("x").is_none());
+            REQUIRE(question_mark::OptionVector<int>(4).get(0).is_none());
+#if QUESTION_MARK_HAS_COROUTINES
+            REQUIRE(sum_digits('1', '2').contains(3));
+            REQUIRE(sum_digits('1', 'x').is_err());
+#endif
+            REQUIRE(recorded_in_headers() == 0);
+            REQUIRE(recorded(event::err, line) == 1);
+        }
+
+        SECTION("a null pointer given to Some is counted at its call") {
+            unsigned line = __LINE__ + 1;
+            auto none = Option<int>::Some(std::unique_ptr<int>());
+            REQUIRE(none.is_none());
+            REQUIRE(recorded(event::none, line) == 1);
+        }
+
+        SECTION("failing unwraps are counted at their call") {
+            question_mark::set_panic_handler(question_mark::throw_on_panic);
+            auto none = Option<int>::None();
+            unsigned line = __LINE__ + 1;
+            REQUIRE_THROWS(none.expect("missing"));
+            REQUIRE_THROWS(Result<int, int>::Ok(1).unwrap_err());
+            REQUIRE_NOTHROW(Option<int>::Some(1).unwrap());
+            question_mark::set_panic_handler(nullptr);
+            REQUIRE(recorded(event::panic, line) == 1);
+            REQUIRE(recorded(event::panic, line + 1) == 1);
+            REQUIRE(recorded(event::panic, line + 2) == 0);
+        }
+
+        SECTION("snapshots export text and JSON") {
+            unsigned line = __LINE__ + 1;
+            Result<int, int>::Err(1);
+            auto report = question_mark::telemetry::snapshot();
+            std::string site = "tests.cpp:" + std::to_string(line);
+            REQUIRE(report.to_text().find(site) != std::string::npos);
+            REQUIRE(report.to_json().find("\"line\":" + std::to_string(line) + ",") != std::string::npos);
+            REQUIRE(report.to_json().find("\"event\":\"err\"") != std::string::npos);
         }
     }
+#endif
 }